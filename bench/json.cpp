@@ -0,0 +1,181 @@
+#include "json.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace sunset
+{
+namespace
+{
+struct JsonParser
+{
+    auto parse() -> JsonValue
+    {
+        auto value = parseValue();
+        skipWhitespace();
+        if (pos != text.size()) {
+            fail("trailing characters");
+        }
+        return value;
+    }
+
+    auto parseValue() -> JsonValue
+    {
+        skipWhitespace();
+        if (pos == text.size()) {
+            fail("unexpected end of input");
+        }
+
+        JsonValue value;
+        switch (text[pos]) {
+            case '{': parseObject(value); break;
+            case '[': parseArray(value); break;
+            case '"':
+                value.type   = JsonValue::Type::String;
+                value.string = parseString();
+                break;
+            case 't':
+            case 'f':
+                value.type    = JsonValue::Type::Bool;
+                value.boolean = text[pos] == 't';
+                expectWord(value.boolean ? "true" : "false");
+                break;
+            case 'n': expectWord("null"); break;
+            default: parseNumber(value); break;
+        }
+        return value;
+    }
+
+    auto parseObject(JsonValue& value) -> void
+    {
+        value.type = JsonValue::Type::Object;
+        expect('{');
+        skipWhitespace();
+        if (consume('}')) {
+            return;
+        }
+
+        do {
+            skipWhitespace();
+            value.keys.push_back(parseString());
+            skipWhitespace();
+            expect(':');
+            value.elements.push_back(parseValue());
+            skipWhitespace();
+        } while (consume(','));
+
+        expect('}');
+    }
+
+    auto parseArray(JsonValue& value) -> void
+    {
+        value.type = JsonValue::Type::Array;
+        expect('[');
+        skipWhitespace();
+        if (consume(']')) {
+            return;
+        }
+
+        do {
+            value.elements.push_back(parseValue());
+            skipWhitespace();
+        } while (consume(','));
+
+        expect(']');
+    }
+
+    auto parseString() -> std::string
+    {
+        expect('"');
+
+        std::string str;
+        while (pos < text.size() && text[pos] != '"') {
+            auto c = text[pos++];
+            if (c == '\\' && pos < text.size()) {
+                c = text[pos++];
+                switch (c) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    default: break;
+                }
+            }
+            str.push_back(c);
+        }
+
+        expect('"');
+        return str;
+    }
+
+    auto parseNumber(JsonValue& value) -> void
+    {
+        std::string number(text.substr(pos, 64));
+        char*       end;
+
+        value.type   = JsonValue::Type::Number;
+        value.number = std::strtod(number.c_str(), &end);
+
+        if (end == number.c_str()) {
+            fail("invalid value");
+        }
+        pos += end - number.c_str();
+    }
+
+    auto skipWhitespace() -> void
+    {
+        while (pos < text.size() && std::isspace((unsigned char)text[pos])) {
+            pos++;
+        }
+    }
+
+    auto consume(char c) -> bool
+    {
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    auto expect(char c) -> void
+    {
+        if (!consume(c)) {
+            fail(std::string("expected '") + c + "'");
+        }
+    }
+
+    auto expectWord(std::string_view word) -> void
+    {
+        if (text.substr(pos, word.size()) != word) {
+            fail("invalid literal");
+        }
+        pos += word.size();
+    }
+
+    [[noreturn]] auto fail(const std::string& what) -> void
+    {
+        throw std::runtime_error(
+        "JSON parse error at offset " + std::to_string(pos) + ": " + what);
+    }
+
+    std::string_view text;
+    size_t           pos = 0;
+};
+}
+
+auto JsonValue::find(std::string_view key) const -> const JsonValue*
+{
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] == key) {
+            return &elements[i];
+        }
+    }
+
+    return nullptr;
+}
+
+auto parseJson(std::string_view text) -> JsonValue
+{
+    return JsonParser{text}.parse();
+}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sunset
+{
+// Just enough JSON to read back the reports the benchmark writes itself.
+struct JsonValue
+{
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    auto find(std::string_view key) const -> const JsonValue*;
+
+    Type                     type    = Type::Null;
+    bool                     boolean = false;
+    float64                  number  = 0.0;
+    std::string              string;
+    std::vector<JsonValue>   elements;
+    std::vector<std::string> keys;  // Parallel to elements for objects.
+};
+
+auto parseJson(std::string_view text) -> JsonValue;
+}
@@ -0,0 +1,588 @@
+#include "json.hpp"
+
+#include "renderer/culling.hpp"
+#include "renderer/renderer.hpp"
+#include "renderer/vulkan/allocator.hpp"
+#include "renderer/vulkan/mesh.hpp"
+#include "renderer/vulkan/pipeline.hpp"
+#include "renderer/vulkan/pipeline_registry.hpp"
+#include "utils/file.hpp"
+#include "utils/memory.hpp"
+#include "utils/profiler.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sunset
+{
+namespace
+{
+struct BenchConfig
+{
+    RendererConfig renderer;
+    uint32         warmupFrames   = 30u;
+    uint32         measuredFrames = 300u;
+    std::string    outputPath     = "sunset_bench.json";
+    std::string    baselinePath;
+    // A percentile regresses when it exceeds the baseline by both margins.
+    float64 tolerance = 0.10;
+    float64 slackMs   = 0.05;
+};
+
+struct BenchScene
+{
+    const char* name;
+    // Adds the meshes it creates to meshes, they are destroyed once the scene
+    // ran.
+    std::function<std::vector<DrawItem>(std::vector<MeshHandle>& meshes)>
+    build;
+};
+
+struct SceneResult
+{
+    std::string                    name;
+    uint32                         frames;
+    float64                        meanMs;
+    float64                        p50Ms;
+    float64                        p95Ms;
+    float64                        p99Ms;
+    float64                        maxMs;
+    std::map<std::string, float64> cpuPhaseMs;
+    std::map<std::string, float64> gpuPhaseMs;
+    // Peak resident memory of the process so far, so it includes every
+    // scene run before this one.
+    uint64  processPeakMemoryKb;
+    uint64  gpuMemoryKb;
+    uint64  gpuAllocationCount;
+    float64 latencyMs;
+    uint64  drawCount;
+    // Unknown when culling on the GPU.
+    std::optional<uint64> visibleDrawCount;
+    // Across the measured frames, only counted in debug builds.
+    uint64 heapAllocations;
+};
+
+// Triangle i of the mesh is shrunk by 1 / (i + 1) so that large scenes stay
+// bound by draw and vertex cost rather than overdraw. Smaller triangles are
+// nearer, so each one passes the depth test over the larger ones.
+auto createShrinkingTriangles(uint32 count) -> MeshHandle
+{
+    const float32 corners[3][2] = {{0.0f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}};
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32> indices;
+    vertices.reserve(count * 3u);
+    indices.reserve(count * 3u);
+
+    for (uint32 i = 0; i < count; i++) {
+        auto scale = 1.0f / (float32)(i + 1u);
+        for (uint32 corner = 0; corner < 3u; corner++) {
+            Vertex vertex{};
+            vertex.position[0]   = corners[corner][0] * scale;
+            vertex.position[1]   = corners[corner][1] * scale;
+            vertex.position[2]   = 0.5f * scale;
+            vertex.color[corner] = 1.0f;
+            indices.push_back((uint32)vertices.size());
+            vertices.push_back(vertex);
+        }
+    }
+
+    return createMesh(vertices, indices);
+}
+
+auto buildScenes() -> std::vector<BenchScene>
+{
+    return {
+    {"triangle",
+     [](std::vector<MeshHandle>&) {
+         return std::vector<DrawItem>{DrawItem{}};
+     }},
+    {"many_draws",
+     [](std::vector<MeshHandle>& meshes) {
+         auto                  mesh = createShrinkingTriangles(4096u);
+         std::vector<DrawItem> items(4096u);
+         meshes.push_back(mesh);
+         for (uint32 i = 0; i < items.size(); i++) {
+             items[i].mesh       = mesh;
+             items[i].firstIndex = i * 3u;
+             items[i].indexCount = 3u;
+         }
+         return items;
+     }},
+    {"repeated_props",
+     [](std::vector<MeshHandle>& meshes) {
+         // One small mesh on a 64 by 64 grid, merged into a single draw.
+         auto                  mesh = createShrinkingTriangles(1u);
+         std::vector<DrawItem> items(4096u);
+         meshes.push_back(mesh);
+         for (uint32 i = 0; i < items.size(); i++) {
+             auto& instance     = items[i].instance;
+             instance.offset[0] = -1.0f + ((i % 64u) + 0.5f) / 32.0f;
+             instance.offset[1] = -1.0f + ((i / 64u) + 0.5f) / 32.0f;
+             instance.scale     = 1.0f / 32.0f;
+             items[i].mesh      = mesh;
+         }
+         return items;
+     }},
+    {"offscreen_draws",
+     [](std::vector<MeshHandle>& meshes) {
+         // Distinct draws spread over three times the view in x and y, so
+         // that most of them are culled.
+         auto                  mesh = createShrinkingTriangles(4096u);
+         std::vector<DrawItem> items(4096u);
+         meshes.push_back(mesh);
+         for (uint32 i = 0; i < items.size(); i++) {
+             auto& instance      = items[i].instance;
+             instance.offset[0]  = -3.0f + ((i % 64u) + 0.5f) * (6.0f / 64u);
+             instance.offset[1]  = -3.0f + ((i / 64u) + 0.5f) * (6.0f / 64u);
+             items[i].mesh       = mesh;
+             items[i].firstIndex = i * 3u;
+             items[i].indexCount = 3u;
+         }
+         return items;
+     }},
+    {"large_vertex_count",
+     [](std::vector<MeshHandle>& meshes) {
+         DrawItem item;
+         item.mesh = createShrinkingTriangles(1000000u);
+         meshes.push_back(item.mesh);
+         return std::vector<DrawItem>{item};
+     }},
+    {"pipeline_churn",
+     [](std::vector<MeshHandle>& meshes) {
+         // Eight distinct pipelines, so every draw rebinds.
+         std::vector<PipelineHandle> pipelines;
+         for (uint32 i = 0; i < 8u; i++) {
+             auto desc        = getDefaultPipelineDesc();
+             desc.blendEnable = (i & 1u) != 0u;
+             if (i & 2u) {
+                 desc.cullMode = VK_CULL_MODE_NONE;
+             }
+             if (i & 4u) {
+                 desc.colorWriteMask = VK_COLOR_COMPONENT_R_BIT |
+                                       VK_COLOR_COMPONENT_G_BIT |
+                                       VK_COLOR_COMPONENT_B_BIT;
+             }
+             pipelines.push_back(requestPipeline(desc));
+         }
+         for (auto pipeline : pipelines) {
+             waitForPipeline(pipeline);
+         }
+
+         auto                  mesh = createShrinkingTriangles(4096u);
+         std::vector<DrawItem> items(4096u);
+         meshes.push_back(mesh);
+         for (uint32 i = 0; i < items.size(); i++) {
+             items[i].mesh       = mesh;
+             items[i].firstIndex = i * 3u;
+             items[i].indexCount = 3u;
+             items[i].pipeline   = pipelines[i % pipelines.size()];
+         }
+         return items;
+     }},
+    };
+}
+
+auto processPeakMemoryKb() -> uint64
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1024u;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    // Bytes on macOS, KiB everywhere else.
+    return usage.ru_maxrss / 1024u;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+auto percentile(const std::vector<float64>& sorted, float64 p) -> float64
+{
+    auto rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// Mean time per measured frame spent in each named zone.
+auto aggregatePhases(
+const std::vector<ProfileEvent>& events, uint64 firstFrame, uint64 lastFrame)
+-> std::map<std::string, float64>
+{
+    std::map<std::string, float64> totals;
+    std::map<uint64, bool>         frames;
+
+    for (const auto& event : events) {
+        if (event.frame < firstFrame || event.frame > lastFrame) {
+            continue;
+        }
+        totals[event.name] += (event.end - event.begin) / 1e6;
+        frames[event.frame] = true;
+    }
+
+    for (auto& [name, total] : totals) {
+        total /= frames.size();
+    }
+
+    return totals;
+}
+
+auto runScene(const BenchConfig& config, const BenchScene& scene)
+-> SceneResult
+{
+    using Clock = std::chrono::steady_clock;
+
+    auto&                   renderer = Renderer::get();
+    std::vector<MeshHandle> meshes;
+    renderer.setDrawItems(scene.build(meshes));
+
+    for (uint32 i = 0; i < config.warmupFrames; i++) {
+        renderer.drawFrame();
+    }
+
+    auto                 firstFrame = renderer.getFrameNumber();
+    std::vector<float64> frameTimes;
+    frameTimes.reserve(config.measuredFrames);
+
+    auto heapAllocations = getHeapAllocationCount();
+    for (uint32 i = 0; i < config.measuredFrames; i++) {
+        auto start = Clock::now();
+        renderer.drawFrame();
+        frameTimes.push_back(
+        std::chrono::duration<float64, std::milli>(Clock::now() - start)
+        .count());
+    }
+    heapAllocations = getHeapAllocationCount() - heapAllocations;
+    auto lastFrame  = renderer.getFrameNumber() - 1;
+    auto latencyMs  = renderer.getLatencyMs();
+
+    // Let the last frames retire so their GPU zones are read back.
+    for (uint32 i = 0; i < config.renderer.framesInFlight; i++) {
+        renderer.drawFrame();
+    }
+    renderer.waitIdle();
+
+    SceneResult result;
+    result.name   = scene.name;
+    result.frames = config.measuredFrames;
+
+    result.meanMs = 0.0;
+    for (auto time : frameTimes) {
+        result.meanMs += time / frameTimes.size();
+    }
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    result.p50Ms = percentile(frameTimes, 0.50);
+    result.p95Ms = percentile(frameTimes, 0.95);
+    result.p99Ms = percentile(frameTimes, 0.99);
+    result.maxMs = frameTimes.back();
+
+    result.latencyMs        = latencyMs;
+    result.drawCount        = renderer.getDrawCount();
+    result.visibleDrawCount = renderer.getVisibleDrawCount();
+    result.heapAllocations  = heapAllocations;
+
+    auto& profiler    = Profiler::get();
+    result.cpuPhaseMs = aggregatePhases(
+    profiler.cpuEvents(), firstFrame, lastFrame);
+    result.gpuPhaseMs = aggregatePhases(
+    profiler.gpuEvents(), firstFrame, lastFrame);
+
+    result.processPeakMemoryKb = processPeakMemoryKb();
+
+    auto gpuMemory            = getAllocatorStats().total;
+    result.gpuMemoryKb        = gpuMemory.blockBytes / 1024;
+    result.gpuAllocationCount = gpuMemory.allocationCount;
+
+    // Drawing only the default mesh again lets the scene meshes go.
+    renderer.setDrawItems({DrawItem{}});
+    for (auto mesh : meshes) {
+        destroyMesh(mesh);
+    }
+
+    return result;
+}
+
+auto writePhases(
+std::ofstream& file, const char* key,
+const std::map<std::string, float64>& phases) -> void
+{
+    file << "      \"" << key << "\": {";
+
+    bool first = true;
+    for (const auto& [name, ms] : phases) {
+        char buffer[128];
+        std::snprintf(
+        buffer, sizeof(buffer), "%s\n        \"%s\": %.6f", first ? "" : ",",
+        name.c_str(), ms);
+        file << buffer;
+        first = false;
+    }
+
+    file << (phases.empty() ? "}" : "\n      }");
+}
+
+auto writeReport(
+const BenchConfig& config, const std::vector<SceneResult>& results) -> void
+{
+    std::ofstream file(config.outputPath, std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + config.outputPath);
+    }
+
+    file << "{\n"
+         << "  \"width\": " << config.renderer.width << ",\n"
+         << "  \"height\": " << config.renderer.height << ",\n"
+         << "  \"frames_in_flight\": " << config.renderer.framesInFlight
+         << ",\n"
+         << "  \"warmup_frames\": " << config.warmupFrames << ",\n"
+         << "  \"reuse_command_buffers\": "
+         << (config.renderer.reuseCommandBuffers ? "true" : "false") << ",\n"
+         << "  \"depth_prepass\": "
+         << (config.renderer.depthPrepass ? "true" : "false") << ",\n"
+         << "  \"gpu_driven\": "
+         << (config.renderer.gpuDriven ? "true" : "false") << ",\n"
+         << "  \"frustum_culling\": "
+         << (config.renderer.frustumCulling ? "true" : "false") << ",\n"
+         << "  \"cull_kernel\": \"" << getCullKernelName(getCullKernel())
+         << "\",\n"
+         << "  \"scenes\": [";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& result = results[i];
+        char        buffer[640];
+        // JSON null when unknown.
+        char visibleDraws[32] = "null";
+        if (result.visibleDrawCount) {
+            std::snprintf(
+            visibleDraws, sizeof(visibleDraws), "%llu",
+            (unsigned long long)*result.visibleDrawCount);
+        }
+
+        std::snprintf(
+        buffer, sizeof(buffer),
+        "%s\n    {\n"
+        "      \"name\": \"%s\",\n"
+        "      \"frames\": %u,\n"
+        "      \"mean_ms\": %.6f,\n"
+        "      \"p50_ms\": %.6f,\n"
+        "      \"p95_ms\": %.6f,\n"
+        "      \"p99_ms\": %.6f,\n"
+        "      \"max_ms\": %.6f,\n"
+        "      \"latency_ms\": %.6f,\n"
+        "      \"draw_calls\": %llu,\n"
+        "      \"visible_draws\": %s,\n"
+        "      \"process_peak_memory_kb\": %llu,\n"
+        "      \"gpu_memory_kb\": %llu,\n"
+        "      \"gpu_allocations\": %llu,\n"
+        "      \"heap_allocations\": %llu,\n",
+        i == 0 ? "" : ",", result.name.c_str(), result.frames, result.meanMs,
+        result.p50Ms, result.p95Ms, result.p99Ms, result.maxMs,
+        result.latencyMs, (unsigned long long)result.drawCount,
+        visibleDraws,
+        (unsigned long long)result.processPeakMemoryKb,
+        (unsigned long long)result.gpuMemoryKb,
+        (unsigned long long)result.gpuAllocationCount,
+        (unsigned long long)result.heapAllocations);
+        file << buffer;
+
+        writePhases(file, "cpu_phase_ms", result.cpuPhaseMs);
+        file << ",\n";
+        writePhases(file, "gpu_phase_ms", result.gpuPhaseMs);
+        file << "\n    }";
+    }
+
+    file << "\n  ]\n}\n";
+}
+
+auto printResult(const SceneResult& result) -> void
+{
+    std::printf(
+    "%-20s mean %8.3f ms  p50 %8.3f  p95 %8.3f  p99 %8.3f  process peak "
+    "%llu KiB\n",
+    result.name.c_str(), result.meanMs, result.p50Ms, result.p95Ms,
+    result.p99Ms, (unsigned long long)result.processPeakMemoryKb);
+
+    for (const auto& [name, ms] : result.cpuPhaseMs) {
+        std::printf("    cpu %-28s %8.3f ms\n", name.c_str(), ms);
+    }
+    for (const auto& [name, ms] : result.gpuPhaseMs) {
+        std::printf("    gpu %-28s %8.3f ms\n", name.c_str(), ms);
+    }
+}
+
+// Returns the number of percentiles that regressed against the baseline.
+auto compareWithBaseline(
+const BenchConfig& config, const std::vector<SceneResult>& results) -> uint32
+{
+    auto data     = readFile(config.baselinePath);
+    auto baseline = parseJson(std::string_view(data.data(), data.size()));
+
+    auto scenes = baseline.find("scenes");
+    if (scenes == nullptr || scenes->type != JsonValue::Type::Array) {
+        throw std::runtime_error("Baseline has no scene list.");
+    }
+
+    uint32 regressions = 0u;
+    for (const auto& result : results) {
+        const JsonValue* baselineScene = nullptr;
+        for (const auto& scene : scenes->elements) {
+            auto name = scene.find("name");
+            if (name != nullptr && name->string == result.name) {
+                baselineScene = &scene;
+            }
+        }
+
+        if (baselineScene == nullptr) {
+            std::printf("%-20s not in baseline, skipped\n", result.name.c_str());
+            continue;
+        }
+
+        std::pair<const char*, float64> metrics[] = {
+        {"p50_ms", result.p50Ms},
+        {"p95_ms", result.p95Ms},
+        {"p99_ms", result.p99Ms}};
+
+        for (const auto& [key, current] : metrics) {
+            auto value = baselineScene->find(key);
+            if (value == nullptr) {
+                continue;
+            }
+
+            auto limit = std::max(
+            value->number * (1.0 + config.tolerance),
+            value->number + config.slackMs);
+            if (current > limit) {
+                std::printf(
+                "REGRESSION %-20s %s %.3f ms > baseline %.3f ms\n",
+                result.name.c_str(), key, current, value->number);
+                regressions++;
+            }
+        }
+    }
+
+    return regressions;
+}
+
+auto parseArgs(int argc, char** argv) -> BenchConfig
+{
+    BenchConfig config;
+    config.renderer.headless = true;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg     = argv[i];
+        bool             hasNext = i + 1 < argc;
+
+        if (arg == "--frames" && hasNext) {
+            config.measuredFrames = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--warmup" && hasNext) {
+            config.warmupFrames = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--frames-in-flight" && hasNext) {
+            config.renderer.framesInFlight =
+            std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--record-every-frame") {
+            config.renderer.reuseCommandBuffers = false;
+        }
+        else if (arg == "--depth-prepass") {
+            config.renderer.depthPrepass = true;
+        }
+        else if (arg == "--gpu-driven") {
+            config.renderer.gpuDriven = true;
+        }
+        else if (arg == "--no-culling") {
+            config.renderer.frustumCulling = false;
+        }
+        else if (arg == "--width" && hasNext) {
+            config.renderer.width = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--height" && hasNext) {
+            config.renderer.height = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--output" && hasNext) {
+            config.outputPath = argv[++i];
+        }
+        else if (arg == "--baseline" && hasNext) {
+            config.baselinePath = argv[++i];
+        }
+        else if (arg == "--tolerance" && hasNext) {
+            config.tolerance = std::strtod(argv[++i], nullptr);
+        }
+        else if (arg == "--slack-ms" && hasNext) {
+            config.slackMs = std::strtod(argv[++i], nullptr);
+        }
+        else {
+            throw std::runtime_error("Unknown argument " + std::string(arg));
+        }
+    }
+
+    if (config.measuredFrames == 0) {
+        throw std::runtime_error("At least one measured frame is required.");
+    }
+
+    return config;
+}
+}
+}
+
+int main(int argc, char** argv)
+{
+    using namespace sunset;
+
+    try {
+        auto config = parseArgs(argc, argv);
+
+        auto& renderer = Renderer::get();
+        renderer.init(config.renderer);
+
+        std::vector<SceneResult> results;
+        for (const auto& scene : buildScenes()) {
+            results.push_back(runScene(config, scene));
+            printResult(results.back());
+        }
+
+        renderer.shutdown();
+
+        writeReport(config, results);
+        std::printf("Wrote %s\n", config.outputPath.c_str());
+
+        if (
+        !config.baselinePath.empty() &&
+        compareWithBaseline(config, results) > 0) {
+            return 1;
+        }
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
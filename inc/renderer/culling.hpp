@@ -0,0 +1,67 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace sunset
+{
+// Points p with dot(normal, p) + distance >= 0 are inside.
+struct Plane
+{
+    float32 normal[3] = {};
+    float32 distance  = 0.0f;
+};
+
+struct Frustum
+{
+    Plane planes[6];
+};
+
+// The view volume of the positions vertex shaders output, which are not
+// transformed: x and y in [-1, 1], z in [0, 1].
+auto getClipSpaceFrustum() -> Frustum;
+
+// Object bounds as structure of arrays, so that kernels load the same field
+// of several objects with one instruction. Each object has a sphere and an
+// axis aligned box sharing its center. It is culled if either lies outside a
+// plane.
+struct CullBounds
+{
+    auto resize(size_t count) -> void;
+    auto size() const -> size_t;
+    auto set(
+    size_t index, const float32 center[3], float32 radius,
+    const float32 extents[3]) -> void;
+
+    std::vector<float32> centerX;
+    std::vector<float32> centerY;
+    std::vector<float32> centerZ;
+    std::vector<float32> radius;
+    // Half the size of the box along each axis.
+    std::vector<float32> extentX;
+    std::vector<float32> extentY;
+    std::vector<float32> extentZ;
+};
+
+enum class CullKernel : uint32
+{
+    Scalar,
+    // 4 objects per instruction, every x86-64 CPU has it.
+    Sse,
+    // 8 objects per instruction.
+    Avx2
+};
+
+// The widest kernel the CPU supports, detected once.
+auto getCullKernel() -> CullKernel;
+auto getCullKernelName(CullKernel kernel) -> const char*;
+
+// Replaces visible with the indices of the objects inside frustum, in
+// ascending order. Large sets are split over the job system. Allocates only
+// when visible has to grow, besides scratch from the frame arena.
+auto cullBounds(
+const CullBounds& bounds, const Frustum& frustum, std::vector<uint32>& visible,
+CullKernel kernel = getCullKernel()) -> void;
+}
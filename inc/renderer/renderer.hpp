@@ -1,39 +1,200 @@
 #pragma once
 
+#include "renderer/culling.hpp"
+#include "renderer/scene.hpp"
+#include "renderer/vulkan/instancing.hpp"
+#include "renderer/vulkan/render_graph.hpp"
+#include "renderer/vulkan/swapchain.hpp"
+#include "utils/frame_limiter.hpp"
+#include "utils/job_system.hpp"
 #include "utils/singleton.hpp"
+#include "utils/type.hpp"
 
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace sunset
 {
+struct RendererConfig
+{
+    uint32 width  = 800u;
+    uint32 height = 600u;
+    // Number of frames the CPU may record ahead of the GPU.
+    uint32 framesInFlight = 2u;
+    // Render into offscreen images without creating a window or surface.
+    bool headless = false;
+    // Stop after this many frames, 0 runs until the window is closed.
+    uint32 frameCount = 0u;
+    // Chrome trace written when F12 is pressed, and on exit if traceOnExit.
+    std::string tracePath   = "sunset_trace.json";
+    bool        traceOnExit = false;
+    // Pipeline cache file, saved on shutdown and every saveInterval seconds.
+    std::string pipelineCachePath             = "cache/pipeline_cache.bin";
+    float64     pipelineCacheSaveIntervalSecs = 60.0;
+    // SPIR-V compiled from GLSL at runtime, see shader_compiler.hpp.
+    std::string shaderCachePath = "cache/shaders";
+    // Persistently mapped staging ring that streams buffer uploads.
+    uint64 uploadRingSize = 32ull << 20;
+    // Scratch memory of the render thread, reset every frame.
+    uint64 frameArenaSize = 1ull << 20;
+    // Job system threads besides the render thread, running pipeline
+    // compiles and draw recording. 0 runs every job inline.
+    uint32 workerThreadCount = autoWorkerCount;
+    // Threads blocking on asynchronous file reads, 0 reads inline.
+    uint32 fileReaderThreadCount = 2u;
+    // Submit the command buffer recorded for a frame slot and image again
+    // while the scene has not changed, instead of recording every frame.
+    bool reuseCommandBuffers = true;
+    // Draw depth first with depth-only pipelines, so the main pass shades
+    // each pixel once. Pays off when fragment shading dominates, vertex work
+    // is done twice.
+    bool depthPrepass = false;
+    // Cull draws in a compute pass and draw them indirectly, one draw call
+    // per pipeline and mesh, so recording costs the same for any scene size.
+    // Ignored without multiDrawIndirect.
+    bool gpuDriven = false;
+    // Skip draws outside the view frustum before recording, on the CPU. The
+    // GPU-driven path culls on its own.
+    bool          frustumCulling = true;
+    PresentPolicy presentPolicy  = PresentPolicy::Balanced;
+    // Frames per second mainLoop paces itself to, 0 runs unlimited.
+    float64 targetFrameRate = 0.0;
+};
+
 struct Renderer : Singleton<Renderer>
 {
     friend Singleton;
-    auto run() -> void;
+    auto run(const RendererConfig& rendererConfig = {}) -> void;
+
+    // Piecewise alternative to run() for tools that drive the frame loop
+    // themselves, such as the benchmark.
+    auto init(const RendererConfig& rendererConfig) -> void;
+    auto drawFrame() -> void;
+    auto waitIdle() -> void;
+    auto shutdown() -> void;
+
+    // Items that only differ in their instance are drawn as one, see
+    // instancing.hpp.
+    auto setDrawItems(const std::vector<DrawItem>& items) -> void;
+    // Draw calls per pass after merging items into instanced draws.
+    auto getDrawCount() const -> size_t;
+    // Of those, the draws left after culling in the last recorded frame.
+    // Unknown when culling on the GPU.
+    auto getVisibleDrawCount() const -> std::optional<size_t>;
+    // Frames are recorded again with the draws inside frustum, the clip
+    // space box by default.
+    auto setCullFrustum(const Frustum& frustum) -> void;
+    // Records every frame again, for changes the renderer cannot see such as
+    // buffer contents rewritten in place.
+    auto invalidateCommandBuffers() -> void;
+    // Compiles every registry pipeline again after shaders changed on disk.
+    // Draws using one are skipped until it is ready again.
+    auto reloadShaders() -> void;
+    auto getFrameNumber() const -> uint64;
+
+    // The swapchain is recreated with the new policy before the next frame.
+    auto setPresentPolicy(PresentPolicy policy) -> void;
+    auto setTargetFrameRate(float64 framesPerSecond) -> void;
+    // Smoothed time from sampling input for a frame until the GPU finished
+    // rendering it. Queueing in the presentation engine after that is not
+    // visible without present timing extensions.
+    auto getLatencyMs() const -> float64;
+    // Heap allocations by any thread between the last two drawFrame calls.
+    // Only counted in debug builds, the steady state should make none.
+    auto getFrameHeapAllocations() const -> uint64;
+    auto getRenderGraphStats() const -> const RenderGraphStats&;
 
 private:
     Renderer() = default;
 
+    // Synchronization state owned by one slot of the frames in flight ring.
+    struct Frame
+    {
+        VkSemaphore imageAvailableSemaphore;
+        // Graphics timeline value of the frame last submitted in this slot.
+        uint64 submitValue = 0u;
+        // When input was sampled for the frame last submitted in this slot.
+        uint64 inputTime = 0u;
+    };
+
+    // What one of the command buffers, indexed by frame slot and swapchain
+    // image, was last recorded for.
+    struct RecordedCommands
+    {
+        // Scene version the buffer can be submitted again for, none if it
+        // has to be recorded again.
+        uint64                   sceneVersion = ~0ull;
+        std::vector<const char*> gpuZones;
+    };
+
     auto initWindow() -> void;
     auto initVulkan() -> void;
 
     auto createSyncObjs() -> void;
+    auto createRenderFinishedSemaphores() -> void;
+    auto destroySyncObjs() -> void;
+
+    auto createFrameCommandBuffers() -> void;
+    auto destroyFrameCommandBuffers() -> void;
+
+    // Passes of a frame, built again whenever the swapchain images change.
+    auto buildRenderGraph() -> void;
+    auto recreateSwapchain() -> bool;
+
+    auto updateDrawBounds() -> void;
+    // Fills visibleDraws, once per scene version.
+    auto cullDraws() -> void;
 
     auto mainLoop() -> void;
-    auto drawFrame() -> void;
+    auto shouldClose() -> bool;
+    auto acquireImage(Frame& frame) -> std::optional<uint32>;
+    auto prepareCommandBuffer(uint32 imageIndex) -> VkCommandBuffer;
+    auto presentImage(uint32 imageIndex) -> void;
+    auto updateLatency(const Frame& frame, uint64 frameCompleted) -> void;
+
+    auto writeTrace() -> void;
 
     auto cleanUp() -> void;
 
-    uint32_t     width  = 800u;
-    uint32_t     height = 600u;
-    GLFWwindow*  window;
+    GLFWwindow* window = nullptr;
+
+    RendererConfig config;
+    uint32         currentFrame   = 0u;
+    uint64         frameNumber    = 0u;
+    bool           traceRequested = false;
+    // Set when the window was resized or presentation reported the swapchain
+    // out of date or suboptimal, it is recreated before the next frame.
+    bool swapchainOutOfDate = false;
+
+    FrameLimiter frameLimiter;
+    // Set by mainLoop when it polls events, 0 when frames are driven
+    // directly and count from the start of drawFrame instead.
+    uint64  inputTime = 0u;
+    float64 latencyMs = 0.0;
+
+    uint64 frameHeapAllocations = 0u;
+    uint64 lastHeapAllocations  = 0u;
+
+    std::vector<InstancedDraw> draws;
+    uint64                     sceneVersion = 0u;
+
+    Frustum             cullFrustum = getClipSpaceFrustum();
+    CullBounds          drawBounds;
+    std::vector<uint32> visibleDraws;
+    // Scene version visibleDraws were culled for.
+    uint64 culledVersion = ~0ull;
+
+    RenderGraph                   renderGraph;
+    std::vector<RecordedCommands> recordedCommands;
 
-    VkSemaphore imageAvailableSemaphore;
-    VkSemaphore renderFinishedSemaphore;
-    VkFence inFlightFence;
+    std::vector<Frame> frames;
+    // Indexed by swapchain image: presentation may still be waiting on the
+    // semaphore when the frame slot comes around again.
+    std::vector<VkSemaphore> renderFinishedSemaphores;
 
     VkSubmitInfo submitInfo;
     VkPresentInfoKHR presentInfo;
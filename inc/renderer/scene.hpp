@@ -0,0 +1,24 @@
+#pragma once
+
+#include "renderer/vulkan/mesh.hpp"
+#include "renderer/vulkan/pipeline_registry.hpp"
+#include "utils/type.hpp"
+
+namespace sunset
+{
+struct DrawItem
+{
+    MeshHandle mesh = defaultMesh;
+    // Index range of the mesh to draw, an indexCount of 0 draws all of it.
+    uint32 firstIndex    = 0u;
+    uint32 indexCount    = 0u;
+    uint32 instanceCount = 1u;
+    // Repeated for each of the instances. Items drawing the same range of a
+    // mesh with the same pipeline are merged into one instanced draw, see
+    // instancing.hpp.
+    Instance instance;
+    // Registry pipeline for the draw, the default graphics pipeline is used
+    // when unset. Draws whose pipeline is still compiling are skipped.
+    PipelineHandle pipeline = invalidPipelineHandle;
+};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace sunset
+{
+enum class MemoryUsage : uint32
+{
+    // Device local, never mapped.
+    GpuOnly,
+    // Host visible and persistently mapped, written by the CPU.
+    CpuToGpu,
+    // Host visible and persistently mapped, preferably cached for readback.
+    GpuToCpu
+};
+
+struct MemoryBlock;
+
+struct Allocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize   offset = 0;
+    VkDeviceSize   size   = 0;
+    // Points at offset inside the mapped block, null for GpuOnly memory.
+    void*  mapped     = nullptr;
+    uint32 memoryType = 0u;
+
+    MemoryBlock* block = nullptr;
+    uint32       node  = ~0u;
+};
+
+struct MemoryStats
+{
+    // Live vkAllocateMemory allocations, including dedicated ones.
+    uint64 blockCount = 0u;
+    uint64 blockBytes = 0u;
+    // Suballocations handed out from those blocks.
+    uint64 allocationCount = 0u;
+    uint64 allocatedBytes  = 0u;
+    uint64 peakBlockBytes  = 0u;
+};
+
+struct AllocatorStats
+{
+    MemoryStats              total;
+    std::vector<MemoryStats> heaps;
+};
+
+// Suballocates large per memory type blocks with a TLSF allocator. Linear and
+// optimal tiling resources live in separate blocks so bufferImageGranularity
+// never has to be padded for, and host visible blocks stay mapped for their
+// whole lifetime. Requests larger than half a block get dedicated memory.
+auto createAllocator() -> void;
+auto destroyAllocator() -> void;
+
+// Uses the memory properties queried by createAllocator.
+auto findMemoryType(uint32 typeFilter, VkMemoryPropertyFlags properties)
+-> uint32;
+
+auto allocateMemory(
+const VkMemoryRequirements& requirements, MemoryUsage usage, bool linear)
+-> Allocation;
+auto freeMemory(Allocation& allocation) -> void;
+
+// Allocate and bind memory for an existing resource.
+auto allocateBufferMemory(VkBuffer buffer, MemoryUsage usage) -> Allocation;
+auto allocateImageMemory(
+VkImage image, VkImageTiling tiling, MemoryUsage usage) -> Allocation;
+
+// No-ops on host coherent memory, ranges are relative to the allocation and
+// expanded to nonCoherentAtomSize.
+auto flushAllocation(
+const Allocation& allocation, VkDeviceSize offset = 0,
+VkDeviceSize size = VK_WHOLE_SIZE) -> void;
+auto invalidateAllocation(
+const Allocation& allocation, VkDeviceSize offset = 0,
+VkDeviceSize size = VK_WHOLE_SIZE) -> void;
+
+auto getAllocatorStats() -> AllocatorStats;
+}
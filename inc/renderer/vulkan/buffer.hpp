@@ -0,0 +1,21 @@
+#pragma once
+
+#include "renderer/vulkan/allocator.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace sunset
+{
+struct Buffer
+{
+    VkBuffer     buffer = VK_NULL_HANDLE;
+    VkDeviceSize size   = 0;
+    Allocation   allocation;
+};
+
+auto createBuffer(
+VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage)
+-> Buffer;
+auto destroyBuffer(Buffer& buffer) -> void;
+}
@@ -1,3 +1,6 @@
+#pragma once
+
+#include "renderer/vulkan/render_graph.hpp"
 #include "utils/type.hpp"
 
 #include <vulkan/vulkan.h>
@@ -5,9 +8,18 @@
 namespace sunset
 {
 auto createCommandPool() -> void;
-auto createCommandBuffer() -> void;
-auto recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex)
--> void;
+auto createCommandBuffers(uint32 count) -> void;
+// Executes the render graph. Returns whether the recorded buffer may be
+// submitted again for as long as the graph and its inputs stay the same. It
+// may not once it acquired uploads or a pass skipped work that was not ready
+// yet.
+auto recordCommandBuffer(
+VkCommandBuffer commandBuffer, RenderGraph& graph, uint32 frameIndex,
+uint32 imageIndex) -> bool;
+// Records into a transient command buffer, endOneTimeCommands submits it to
+// the graphics queue and waits for it to finish.
+auto beginOneTimeCommands() -> VkCommandBuffer;
+auto endOneTimeCommands(VkCommandBuffer commandBuffer) -> void;
 auto destroyCommandPool() -> void;
-auto destroyCommandBuffer() -> void;
+auto destroyCommandBuffers() -> void;
 }
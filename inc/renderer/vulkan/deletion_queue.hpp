@@ -0,0 +1,27 @@
+#pragma once
+
+#include "renderer/vulkan/timeline.hpp"
+#include "utils/type.hpp"
+
+#include <functional>
+
+namespace sunset
+{
+// Destroys resources once the GPU has passed the last submission using them,
+// so swapchain rebuilds, pipeline reloads and mesh eviction never have to
+// wait for the device to go idle. Only the render thread may use it.
+auto createDeletionQueue() -> void;
+// Waits for everything submitted so far and destroys whatever is left.
+auto destroyDeletionQueue() -> void;
+
+// Calls destroy once value has completed on the timeline, right away if it
+// already has.
+auto deferDestroy(
+Timeline timeline, uint64 value, std::function<void()> destroy) -> void;
+// Keyed on the last graphics submission so far, for resources that nothing
+// recorded from now on references.
+auto deferDestroy(std::function<void()> destroy) -> void;
+
+// Runs the deletions the GPU has finished with, once per frame.
+auto collectDeletions() -> void;
+}
@@ -13,4 +13,13 @@ auto createDevice(
 const std::vector<std::string>& extensionNames,
 const std::vector<std::string>& layerNames) -> void;
 auto destroyDevice() -> void;
+// Whether the device was created with timeline semaphores, which needs
+// Vulkan 1.2 on both the instance and the device.
+auto isTimelineSemaphoreEnabled() -> bool;
+// vkCmdDrawIndexedIndirectCount, core in Vulkan 1.2.
+auto isDrawIndirectCountEnabled() -> bool;
+// Indirect draws with a draw count above one.
+auto isMultiDrawIndirectEnabled() -> bool;
+// First depth format the device supports as an optimally tiled attachment.
+auto findDepthFormat() -> VkFormat;
 }
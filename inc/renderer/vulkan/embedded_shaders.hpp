@@ -0,0 +1,14 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <span>
+#include <string_view>
+
+namespace sunset
+{
+// SPIR-V compiled from shader/ at build time by the embed_spirv rule in
+// xmake.lua, named by the path relative to shader/, such as "basic.vert".
+// Empty if no shader of that name was embedded.
+auto findEmbeddedShader(std::string_view name) -> std::span<const uint32>;
+}
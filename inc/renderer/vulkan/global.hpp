@@ -18,21 +18,25 @@ extern VkPhysicalDevice physicalDevice;
 extern VkDevice         device;
 extern VkQueue          graphicsQueue;
 extern VkQueue          presentQueue;
+extern VkQueue          transferQueue;
 
 extern VkSwapchainKHR   swapchain;
 extern std::vector<VkImage> swapchainImages;
 extern std::vector<VkImageView> swapchainImageViews;
-extern std::vector<VkFramebuffer> swapchainFramebuffers;
 extern VkFormat swapchainImageFormat;
+extern VkImageLayout swapchainImageLayout;
 extern VkExtent2D swapchainExtent;
+extern VkFormat depthFormat;
 
 extern VkViewport viewport;
 extern VkRect2D scissor;
 
 extern VkPipelineLayout pipelineLayout;
 extern VkRenderPass renderPass;
+extern VkRenderPass depthPrepassRenderPass;
 extern VkPipeline graphicsPipeline;
+extern VkPipelineCache pipelineCache;
 
 extern VkCommandPool commandPool;
-extern VkCommandBuffer commandBuffer;
+extern std::vector<VkCommandBuffer> commandBuffers;
 }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "utils/profiler.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <span>
+#include <vector>
+
+namespace sunset
+{
+auto createGpuProfiler(uint32 framesInFlight) -> void;
+auto destroyGpuProfiler() -> void;
+
+// Hands the zones written the last time this frame slot was used over to the
+// profiler and makes the slot current. Call once the slot's fence has been
+// waited on, before recording its command buffer.
+auto beginGpuProfilerFrame(uint32 frameIndex, uint64 frameNumber) -> void;
+// When the GPU finished the frame handed over by beginGpuProfilerFrame, in
+// the profiler's time base. 0 if timestamps are unavailable.
+auto getGpuFrameEnd() -> uint64;
+// Resets the current slot's queries, must be recorded outside a render pass
+// before any zone.
+auto resetGpuZones(VkCommandBuffer commandBuffer) -> void;
+auto beginGpuZone(VkCommandBuffer commandBuffer, const char* name) -> uint32;
+auto endGpuZone(VkCommandBuffer commandBuffer, uint32 zone) -> void;
+
+// Names of the zones recorded into the current slot. A command buffer that
+// is submitted again writes the same queries, so restoring its zones after
+// beginGpuProfilerFrame keeps them in the trace.
+auto getGpuZones() -> std::span<const char* const>;
+auto setGpuZones(const std::vector<const char*>& names) -> void;
+
+struct GpuProfileZone
+{
+    GpuProfileZone(VkCommandBuffer commandBuffer, const char* name);
+    ~GpuProfileZone();
+
+    GpuProfileZone(const GpuProfileZone&)            = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+private:
+    VkCommandBuffer commandBuffer;
+    uint32          zone;
+};
+
+#define GPU_PROFILE_ZONE(COMMAND_BUFFER, NAME)                     \
+    ::sunset::GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)( \
+    COMMAND_BUFFER, NAME)
+}
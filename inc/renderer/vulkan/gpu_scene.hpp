@@ -0,0 +1,52 @@
+#pragma once
+
+#include "renderer/culling.hpp"
+#include "renderer/vulkan/instancing.hpp"
+#include "renderer/vulkan/pipeline.hpp"
+#include "renderer/vulkan/render_graph.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace sunset
+{
+// GPU-driven rendering: draw items live in a storage buffer, a compute pass
+// culls them against the view volume and writes their indirect commands, and
+// draw passes issue a single indirect draw per pipeline and mesh. Recording
+// a frame costs the same however many draws there are. Needs
+// multiDrawIndirect, draws are compacted with vkCmdDrawIndexedIndirectCount
+// where it is available and written with no instances otherwise.
+auto createGpuScene() -> void;
+auto destroyGpuScene() -> void;
+
+// Draws are grouped by pipeline and mesh, draw order is only kept within a
+// group. They are culled by their bounds, with every instance or none, and
+// nothing is drawn until they finished uploading. Returns true if the
+// culling outputs had to grow, the render graph has to be built again with
+// addGpuCullPasses then.
+auto setGpuSceneDraws(const std::vector<InstancedDraw>& instancedDraws)
+-> bool;
+// The clip space box until set. Takes effect once the cull pass is recorded
+// again.
+auto setGpuCullFrustum(const Frustum& frustum) -> void;
+
+struct GpuCullOutputs
+{
+    RenderResource commands;
+    RenderResource counts;
+};
+
+// Adds the passes resetting the draw counts and culling. Passes drawing the
+// scene read both outputs as ResourceUsage::IndirectRead.
+auto addGpuCullPasses(RenderGraph& graph) -> GpuCullOutputs;
+// After the graph is compiled.
+auto bindGpuCullOutputs(const RenderGraph& graph, GpuCullOutputs outputs)
+-> void;
+
+// Pass callback drawing the scene with the variant of each pipeline. Returns
+// false if draws were skipped, see PassCallback.
+auto recordGpuSceneDraws(const PassContext& pass, PipelineVariant variant)
+-> bool;
+}
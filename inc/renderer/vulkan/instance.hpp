@@ -11,4 +11,6 @@ auto createInstance(
     const std::vector<std::string>& extensionNames,
     const std::vector<std::string>& layerNames) -> void;
 auto destroyInstance() -> void;
+// Vulkan version the instance was created for, 1.2 when the loader has it.
+auto getInstanceApiVersion() -> uint32;
 }
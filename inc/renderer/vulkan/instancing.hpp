@@ -0,0 +1,45 @@
+#pragma once
+
+#include "renderer/scene.hpp"
+#include "renderer/vulkan/mesh.hpp"
+#include "renderer/vulkan/pipeline.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace sunset
+{
+// Draw items that only differ in their instance become a single instanced
+// draw. The instances of every draw are packed into one buffer, bound to the
+// per-instance binding of getVertexLayout.
+struct InstancedDraw
+{
+    MeshHandle     mesh;
+    PipelineHandle pipeline;
+    uint32         firstIndex;
+    uint32         indexCount;
+    uint32         firstInstance;
+    uint32         instanceCount;
+    // Around every instance of the mesh, and half the size of the box around
+    // them, centered on the sphere.
+    BoundingSphere bounds;
+    float32        extents[3];
+};
+
+// Uploads the instances of drawItems, replacing those of the previous call.
+// Draws are in the order of their first item, with the default pipeline and
+// the index count of the whole mesh filled in. Render thread only, the
+// meshes must exist.
+auto buildInstancedDraws(const std::vector<DrawItem>& drawItems)
+-> std::vector<InstancedDraw>;
+// Releases the buffers of earlier calls once they finished uploading. Called
+// once per frame, so that they do not wait for the next call.
+auto collectInstanceBuffers() -> void;
+auto destroyInstances() -> void;
+
+// Returns false while the instances are uploading, nothing may be drawn
+// then.
+auto bindInstances(VkCommandBuffer commandBuffer) -> bool;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "renderer/vulkan/buffer.hpp"
+#include "renderer/vulkan/pipeline.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace sunset
+{
+struct Vertex
+{
+    float32 position[3];
+    float32 color[3];
+};
+
+// Per-instance vertex data, vertex positions are scaled and then offset.
+struct Instance
+{
+    float32 offset[3] = {};
+    float32 scale     = 1.0f;
+};
+
+// In the space vertex shaders output, positions are passed through as they
+// are.
+struct BoundingSphere
+{
+    float32 center[3] = {};
+    float32 radius    = 0.0f;
+};
+
+using MeshHandle = uint32;
+
+// Single triangle created by createMeshes, drawn by default draw items.
+constexpr MeshHandle defaultMesh = 0u;
+
+struct Mesh
+{
+    Buffer      vertexBuffer;
+    Buffer      indexBuffer;
+    uint32      vertexCount = 0u;
+    uint32      indexCount  = 0u;
+    VkIndexType indexType   = VK_INDEX_TYPE_UINT32;
+    // Around every vertex, draws of part of the mesh are culled with it too.
+    BoundingSphere bounds;
+    // Draws are skipped until both buffers have finished uploading.
+    uint64 uploadValue = 0u;
+};
+
+// Vertex at binding 0, advancing per vertex, and Instance at binding 1,
+// advancing per instance.
+auto getVertexLayout() -> VertexLayout;
+
+auto createMeshes() -> void;
+auto destroyMeshes() -> void;
+
+// Streams into device local buffers, indices are stored as 16 bit whenever
+// the vertex count allows it. Meshes live until destroyMesh or destroyMeshes
+// and must be created and looked up on the render thread.
+auto createMesh(
+const std::vector<Vertex>& vertices, const std::vector<uint32>& indices)
+-> MeshHandle;
+// Frees the buffers once the frames already submitted are done with them.
+// Draw items must stop referencing the mesh first, and its upload must have
+// completed. The handle may be returned again by createMesh.
+auto destroyMesh(MeshHandle handle) -> void;
+auto getMesh(MeshHandle handle) -> const Mesh&;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+namespace sunset
+{
+// Headless replacement for the swapchain: fills the swapchain globals with
+// device local images that are rendered to but never presented.
+auto createOffscreenTargets(uint32 width, uint32 height, uint32 imageCount)
+-> void;
+auto destroyOffscreenTargets() -> void;
+}
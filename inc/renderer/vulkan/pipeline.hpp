@@ -1,7 +1,82 @@
 #pragma once
 
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
 namespace sunset
 {
+using PipelineHandle = uint32;
+
+constexpr PipelineHandle invalidPipelineHandle = ~0u;
+
+// Bindings advance per vertex or per instance, as their inputRate says.
+struct VertexLayout
+{
+    std::vector<VkVertexInputBindingDescription>   bindings;
+    std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+// Everything that distinguishes one graphics pipeline from another. Viewport
+// and scissor are always dynamic and therefore not part of the description.
+struct PipelineDesc
+{
+    auto operator==(const PipelineDesc& other) const -> bool;
+    auto hash() const -> uint64;
+
+    // Embedded shader names, GLSL or SPIR-V file paths, see
+    // createShaderModule. Defines are NAME or NAME=VALUE, for both stages.
+    // Without a fragment shader the pipeline is depth only, for a render
+    // pass without color attachments.
+    std::string              vertexShader;
+    std::string              fragmentShader;
+    std::vector<std::string> shaderDefines;
+    VertexLayout             vertexLayout;
+
+    VkPrimitiveTopology   topology         = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode         polygonMode      = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags       cullMode         = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace           frontFace        = VK_FRONT_FACE_CLOCKWISE;
+    bool                  blendEnable      = false;
+    VkColorComponentFlags colorWriteMask   = VK_COLOR_COMPONENT_R_BIT |
+                                             VK_COLOR_COMPONENT_G_BIT |
+                                             VK_COLOR_COMPONENT_B_BIT |
+                                             VK_COLOR_COMPONENT_A_BIT;
+    bool                  depthTestEnable  = false;
+    bool                  depthWriteEnable = false;
+    VkCompareOp           depthCompareOp   = VK_COMPARE_OP_LESS;
+
+    // VK_NULL_HANDLE selects the global renderPass and pipelineLayout.
+    VkRenderPass     renderPass = VK_NULL_HANDLE;
+    VkPipelineLayout layout     = VK_NULL_HANDLE;
+};
+
+// Variants of a pipeline for the depth prepass, see getPipelineVariant.
+enum class PipelineVariant : uint32
+{
+    Default,
+    // Depth only, against depthPrepassRenderPass.
+    DepthPrepass,
+    // For the main pass after the prepass, depth is not written. Opaque
+    // surfaces test for the depth the prepass wrote with EQUAL, so each
+    // pixel is shaded once.
+    DepthEqual
+};
+
+constexpr uint32 pipelineVariantCount = 3u;
+
+// Opaque and depth tested, for the main render pass.
+auto getDefaultPipelineDesc() -> PipelineDesc;
+auto getPipelineVariantDesc(const PipelineDesc& desc, PipelineVariant variant)
+-> PipelineDesc;
+// Compiles desc on the calling thread. Safe to call from any thread.
+auto buildGraphicsPipeline(const PipelineDesc& desc) -> VkPipeline;
+
 auto createGraphicsPipeline() -> void;
+// Registry handle of graphicsPipeline, used by draws without a pipeline.
+auto getDefaultPipeline() -> PipelineHandle;
 auto destroyGraphicsPipeline() -> void;
 }
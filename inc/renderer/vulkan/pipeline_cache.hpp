@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string_view>
+
+namespace sunset
+{
+// Creates pipelineCache, seeded from path when the file was written by the
+// same driver on the same device. Anything else is ignored and the cache
+// starts out empty.
+auto createPipelineCache(std::string_view path) -> void;
+// Starts reading path on a file reader, so the file is loaded while the
+// device is being created. createPipelineCache reads it otherwise.
+auto prefetchPipelineCache(std::string_view path) -> void;
+// Writes the cache back to the path it was loaded from if it has grown.
+auto savePipelineCache() -> void;
+auto destroyPipelineCache() -> void;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "renderer/vulkan/pipeline.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace sunset
+{
+// Pipelines are deduplicated by their description and compiled as background
+// jobs, so requesting one never stalls the caller, and neither does a frame
+// waiting on other jobs.
+auto createPipelineRegistry() -> void;
+auto destroyPipelineRegistry() -> void;
+
+auto requestPipeline(const PipelineDesc& desc) -> PipelineHandle;
+// VK_NULL_HANDLE while the pipeline is still compiling or failed to compile.
+auto getPipeline(PipelineHandle handle) -> VkPipeline;
+// Blocks until the pipeline is ready, compiling it on the calling thread if
+// no job has picked it up yet.
+auto waitForPipeline(PipelineHandle handle) -> VkPipeline;
+// Handle of the variant of a pipeline, requested the first time it is asked
+// for. Safe to call while recording, later calls only load the cached handle.
+auto getPipelineVariant(PipelineHandle handle, PipelineVariant variant)
+-> PipelineHandle;
+// Compiles every ready or failed pipeline again, for instance after their
+// shaders changed. getPipeline returns VK_NULL_HANDLE until the new one is
+// ready, the old one is destroyed after the frames using it. Render thread
+// only, and command buffers recorded before must not be submitted again.
+auto reloadPipelines() -> void;
+}
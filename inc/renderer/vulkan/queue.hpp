@@ -14,6 +14,9 @@ struct QueueFamilyIndices
 
     std::optional<uint32> graphicsFamily;
     std::optional<uint32> presentFamily;
+    // Transfer capable family without graphics support, if the device has
+    // one. Uploads fall back to the graphics queue otherwise.
+    std::optional<uint32> transferFamily;
 };
 
 auto findQueueFamilies(VkPhysicalDevice device) -> QueueFamilyIndices;
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "renderer/vulkan/instancing.hpp"
+#include "renderer/vulkan/render_graph.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace sunset
+{
+// Records the draw list of a pass. Lists long enough to be worth it are split
+// into slices that jobs record as secondary command buffers, each slice
+// owning one buffer per frame in flight, swapchain image and pipeline variant
+// so that recorded frames can be submitted again.
+auto createDrawRecorder(uint32 framesInFlight, uint32 imageCount) -> void;
+auto destroyDrawRecorder() -> void;
+
+// How a pass has to be begun for recordDraws with this many draws.
+auto getDrawContents(size_t drawCount) -> VkSubpassContents;
+// Called as a render graph pass callback, after the frame fence has been
+// waited on. Records the draws at the visible indices, in that order, with
+// the variant of their pipeline for the pass. Returns false if draws were
+// skipped because their pipeline or mesh was not ready yet, or the instances
+// were still uploading.
+auto recordDraws(
+const PassContext& pass, const std::vector<InstancedDraw>& draws,
+const std::vector<uint32>& visible,
+PipelineVariant variant = PipelineVariant::Default) -> bool;
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "renderer/vulkan/allocator.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace sunset
+{
+using RenderResource = uint32;
+
+constexpr RenderResource invalidRenderResource = ~0u;
+
+enum class PassType : uint32
+{
+    // Runs inside a render pass the graph begins over its attachments.
+    Graphics,
+    Compute,
+    Transfer
+};
+
+// How a pass uses a resource besides as an attachment. Shader stages are
+// those of the pass type: vertex and fragment for graphics passes.
+enum class ResourceUsage : uint32
+{
+    Sampled,
+    StorageRead,
+    StorageWrite,
+    IndirectRead,
+    VertexRead,
+    IndexRead,
+    UniformRead,
+    TransferRead,
+    TransferWrite
+};
+
+// Transient images are created by the graph and may share memory with
+// others whose passes do not overlap. Their contents do not survive the
+// frame.
+struct RenderImageDesc
+{
+    VkFormat   format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {};
+};
+
+// Transient buffers are created by the graph, they are not aliased.
+struct RenderBufferDesc
+{
+    VkDeviceSize size = 0u;
+};
+
+// An image owned elsewhere, such as the swapchain. With several images the
+// one used is picked by the image index passed to execute.
+struct ImportedImageDesc
+{
+    VkFormat                 format = VK_FORMAT_UNDEFINED;
+    VkExtent2D               extent = {};
+    std::vector<VkImage>     images;
+    std::vector<VkImageView> views;
+    // Layout at the start of every frame, undefined discards the contents.
+    VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Layout the graph leaves the image in at the end of every frame.
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Stages earlier work on the image is waited for in, such as the stage a
+    // swapchain acquire semaphore is waited on.
+    VkPipelineStageFlags initialStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+};
+
+struct PassContext
+{
+    VkCommandBuffer commandBuffer;
+    uint32          frameIndex;
+    uint32          imageIndex;
+    // The render pass and framebuffer begun for graphics passes, null for
+    // other passes.
+    VkRenderPass  renderPass;
+    VkFramebuffer framebuffer;
+    VkExtent2D    extent;
+};
+
+// Records the pass. Returns false if it skipped work that was not ready yet,
+// so the command buffer has to be recorded again next frame.
+using PassCallback = std::function<bool(const PassContext& context)>;
+
+struct RenderGraphStats
+{
+    uint32 passCount       = 0u;
+    uint32 culledPassCount = 0u;
+    // vkCmdPipelineBarrier calls per frame, each batching every barrier a
+    // pass needs.
+    uint32 barrierBatchCount = 0u;
+    // Memory transient images would take without aliasing, and with it.
+    uint64 transientImageBytes  = 0u;
+    uint64 transientMemoryBytes = 0u;
+};
+
+struct RenderGraph;
+
+// Declares what a pass accesses. Each resource may be declared once per pass.
+struct PassBuilder
+{
+    // Without a clear color the previous contents are loaded, or left
+    // undefined if nothing wrote them before in the frame.
+    auto writeColor(
+    RenderResource image, std::optional<VkClearColorValue> clear = {})
+    -> PassBuilder&;
+    auto writeDepth(
+    RenderResource image, std::optional<VkClearDepthStencilValue> clear = {})
+    -> PassBuilder&;
+    // Depth testing without depth writes.
+    auto readDepth(RenderResource image) -> PassBuilder&;
+    auto read(RenderResource resource, ResourceUsage usage) -> PassBuilder&;
+    auto write(RenderResource resource, ResourceUsage usage) -> PassBuilder&;
+
+    // How the render pass is begun, inline unless set.
+    auto setContents(std::function<VkSubpassContents()> contents)
+    -> PassBuilder&;
+    auto setExecute(PassCallback execute) -> PassBuilder&;
+
+    RenderGraph* graph;
+    uint32       pass;
+};
+
+// Passes declare the resources they read and write, compile derives
+// everything else once: passes that contribute nothing to an output are
+// culled, transient images whose passes do not overlap share memory, render
+// passes get load and store ops that skip unused contents, and the layout
+// transitions and barriers each pass needs are batched in front of it.
+// Barriers also order a frame after the previous one on the same queue, so
+// transient resources need no copy per frame in flight. The graph is built
+// again when its images change, and executed into every recorded frame.
+struct RenderGraph
+{
+    auto importImage(const char* name, const ImportedImageDesc& desc)
+    -> RenderResource;
+    auto importBuffer(const char* name, VkBuffer buffer, VkDeviceSize size)
+    -> RenderResource;
+    auto createImage(const char* name, const RenderImageDesc& desc)
+    -> RenderResource;
+    auto createBuffer(const char* name, const RenderBufferDesc& desc)
+    -> RenderResource;
+    // Keeps the passes writing resource. Imported images are outputs anyway.
+    auto markOutput(RenderResource resource) -> void;
+
+    // Names must outlive the graph, they are used as GPU profiler zones.
+    auto addPass(const char* name, PassType type) -> PassBuilder;
+
+    auto compile() -> void;
+    auto destroy() -> void;
+
+    // Returns false if a pass skipped work, see PassCallback.
+    auto execute(
+    VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIndex)
+    -> bool;
+
+    // Physical resources for pass callbacks, after compile.
+    auto getImage(RenderResource resource, uint32 imageIndex = 0u) const
+    -> VkImage;
+    auto getImageView(RenderResource resource, uint32 imageIndex = 0u) const
+    -> VkImageView;
+    auto getBuffer(RenderResource resource) const -> VkBuffer;
+
+    auto getStats() const -> const RenderGraphStats&;
+
+private:
+    friend PassBuilder;
+
+    struct Resource
+    {
+        const char* name;
+        bool        isImage;
+        bool        imported;
+        bool        output = false;
+
+        VkFormat                 format        = VK_FORMAT_UNDEFINED;
+        VkImageAspectFlags       aspect        = 0u;
+        VkExtent2D               extent        = {};
+        VkImageUsageFlags        imageUsage    = 0u;
+        std::vector<VkImage>     images;
+        std::vector<VkImageView> views;
+        VkImageLayout            initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout            finalLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags     initialStages = 0u;
+
+        VkDeviceSize       size        = 0u;
+        VkBufferUsageFlags bufferUsage = 0u;
+        VkBuffer           buffer      = VK_NULL_HANDLE;
+        Allocation         allocation;
+
+        // Passes using it first and last, alias slot for transient images.
+        uint32 firstPass = ~0u;
+        uint32 lastPass  = 0u;
+        uint32 slot      = ~0u;
+    };
+
+    enum class AccessKind : uint32
+    {
+        Color,
+        Depth,
+        DepthRead,
+        // Any use but as an attachment, described by the ResourceUsage.
+        Usage
+    };
+
+    struct Access
+    {
+        RenderResource resource;
+        AccessKind     kind;
+        ResourceUsage  usage      = ResourceUsage::Sampled;
+        bool           write      = false;
+        bool           clear      = false;
+        VkClearValue   clearValue = {};
+    };
+
+    // What an access needs from the resource.
+    struct UsageInfo
+    {
+        VkPipelineStageFlags stages      = 0u;
+        VkAccessFlags        access      = 0u;
+        VkImageLayout        layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageUsageFlags    imageUsage  = 0u;
+        VkBufferUsageFlags   bufferUsage = 0u;
+    };
+
+    struct ImageBarrier
+    {
+        RenderResource resource;
+        VkImageLayout  oldLayout;
+        VkImageLayout  newLayout;
+        VkAccessFlags  srcAccess;
+        VkAccessFlags  dstAccess;
+    };
+
+    // Everything recorded before a pass, in a single vkCmdPipelineBarrier.
+    struct BarrierBatch
+    {
+        VkPipelineStageFlags      srcStages       = 0u;
+        VkPipelineStageFlags      dstStages       = 0u;
+        VkAccessFlags             srcMemoryAccess = 0u;
+        VkAccessFlags             dstMemoryAccess = 0u;
+        std::vector<ImageBarrier> imageBarriers;
+    };
+
+    struct Pass
+    {
+        const char*                        name;
+        PassType                           type;
+        std::vector<Access>                accesses;
+        std::function<VkSubpassContents()> contents;
+        PassCallback                       execute;
+
+        bool                       culled = false;
+        BarrierBatch               barriers;
+        VkRenderPass               renderPass = VK_NULL_HANDLE;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkClearValue>  clearValues;
+        VkExtent2D                 extent = {};
+    };
+
+    // Synchronization state of a resource, or of the memory of an alias
+    // slot, between passes.
+    struct SyncState
+    {
+        VkImageLayout        layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0u;
+        VkAccessFlags        writeAccess = 0u;
+        // Stages that read since the last write and waited for it.
+        VkPipelineStageFlags readStages = 0u;
+    };
+
+    static auto getUsageInfo(const Access& access, PassType type) -> UsageInfo;
+
+    auto addAccess(uint32 pass, const Access& access) -> void;
+    auto cullPasses() -> void;
+    auto createTransients() -> void;
+    auto createRenderPasses() -> void;
+    // Run once to find the state at the end of a frame, and again starting
+    // from it to get the barriers of the next one.
+    auto computeBarriers(std::vector<SyncState>& slotStates) -> void;
+    auto recordBarriers(
+    VkCommandBuffer commandBuffer, const BarrierBatch& batch,
+    uint32 imageIndex) const -> void;
+
+    std::vector<Resource>   resources;
+    std::vector<Pass>       passes;
+    BarrierBatch            finalBarriers;
+    std::vector<Allocation> slotAllocations;
+    uint32                  slotCount = 0u;
+    RenderGraphStats        stats;
+};
+}
@@ -2,6 +2,9 @@
 
 namespace sunset
 {
+// Pipelines are created against these render passes, they are never begun.
+// renderPass is compatible with the render graph's main pass, a color and a
+// depth attachment, depthPrepassRenderPass with its depth prepass.
 auto createRenderPass() -> void;
 auto destroyRenderPass() -> void;
 }
@@ -1,10 +1,17 @@
 #pragma once
 
+#include <span>
+#include <string>
 #include <string_view>
 #include <vulkan/vulkan.h>
 
 namespace sunset
 {
-auto createShaderModule(std::string_view shaderPath) -> VkShaderModule;
+// shader names an embedded shader, see embedded_shaders.hpp, unless there are
+// defines. Otherwise GLSL sources are compiled, see shader_compiler.hpp, and
+// anything else is taken as the path to a SPIR-V file.
+auto createShaderModule(
+std::string_view shader, std::span<const std::string> defines = {})
+-> VkShaderModule;
 auto destroyShaderModule(VkShaderModule shaderModule) -> void;
 }
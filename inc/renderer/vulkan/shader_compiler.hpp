@@ -0,0 +1,27 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sunset
+{
+// Compiles GLSL at runtime through shaderc, for development and for shaders
+// that are not embedded. Results are cached in cacheDirectory under the hash
+// of the preprocessed source, so edits to includes and defines that change
+// the code miss the cache and everything else hits it, across launches.
+// Builds without the shaderc option in xmake.lua cannot compile GLSL.
+auto createShaderCompiler(std::string_view cacheDirectory) -> void;
+auto destroyShaderCompiler() -> void;
+
+// Whether path names a GLSL source, by its extension: .vert, .frag, .comp,
+// .geom, .tesc, .tese, or .glsl with a #pragma shader_stage.
+auto isGlslShader(std::string_view path) -> bool;
+// Defines are NAME or NAME=VALUE. Throws with the compiler's messages if the
+// source does not compile. Safe to call from any thread.
+auto compileShader(std::string_view path, std::span<const std::string> defines)
+-> std::vector<uint32>;
+}
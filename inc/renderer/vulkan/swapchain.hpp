@@ -4,19 +4,40 @@
 
 #include <vulkan/vulkan.h>
 
+#include <memory_resource>
 #include <vector>
 
 namespace sunset
 {
+enum class PresentPolicy : uint32
+{
+    // Immediate or mailbox presentation with as few images as allowed, new
+    // frames replace queued ones instead of waiting behind them.
+    LowLatency,
+    // Mailbox when available, otherwise FIFO, with one spare image.
+    Balanced,
+    // FIFO with a deeper image queue so the GPU never starves, at the cost
+    // of frames waiting longer before they are shown.
+    Throughput
+};
+
 struct SwapchainSupportDetails
 {
-    VkSurfaceCapabilitiesKHR        capabilities;
-    std::vector<VkSurfaceFormatKHR> formats;
-    std::vector<VkPresentModeKHR>   presentModes;
+    VkSurfaceCapabilitiesKHR             capabilities;
+    std::pmr::vector<VkSurfaceFormatKHR> formats;
+    std::pmr::vector<VkPresentModeKHR>   presentModes;
 };
 
-auto getSwapchainSupportDetails(VkPhysicalDevice device)
+// The lists are allocated from resource, usually the frame arena.
+auto getSwapchainSupportDetails(
+VkPhysicalDevice           device,
+std::pmr::memory_resource* resource = std::pmr::get_default_resource())
 -> SwapchainSupportDetails;
-auto createSwapchain(uint32 width, uint32 height) -> void;
-auto destroySwapchain()->void;
+// Replaces the current swapchain, if any, passing it as oldSwapchain so
+// presentation can hand over without a gap. The replaced swapchain and its
+// image views are left to the caller, which destroys them once no frame in
+// flight uses them any more.
+auto createSwapchain(uint32 width, uint32 height, PresentPolicy policy)
+-> void;
+auto destroySwapchain() -> void;
 }
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace sunset
+{
+// GPU progress of a queue as a monotonically increasing value. Every
+// submission made through submitToTimeline signals the next value when it
+// completes, so frames, upload batches and the resources retired after them
+// are all tracked as plain numbers instead of fences of their own.
+//
+// Backed by one timeline semaphore per queue when the device supports them
+// (Vulkan 1.2), and by a pooled fence per submission otherwise. A single
+// semaphore cannot be shared: queues complete out of order relative to each
+// other, and a timeline must never be signaled backwards. Only the render
+// thread may use the timeline functions.
+enum class Timeline : uint32
+{
+    // Submissions to graphicsQueue.
+    Graphics,
+    // Submissions to transferQueue, which may be the graphics queue.
+    Transfer,
+};
+
+constexpr uint32 timelineCount = 2u;
+
+auto createTimelines() -> void;
+auto destroyTimelines() -> void;
+
+// Submits to the queue of the timeline and returns the value it reaches once
+// the submission completes. Binary semaphores in submitInfo are kept.
+auto submitToTimeline(Timeline timeline, const VkSubmitInfo& submitInfo)
+-> uint64;
+
+auto getSubmittedValue(Timeline timeline) -> uint64;
+// Highest value whose submission, and every one before it, has completed.
+auto getCompletedValue(Timeline timeline) -> uint64;
+auto isValueComplete(Timeline timeline, uint64 value) -> bool;
+auto waitForValue(Timeline timeline, uint64 value) -> void;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "renderer/vulkan/buffer.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+namespace sunset
+{
+// Streams data to device local buffers through a persistently mapped staging
+// ring. Copies are batched and submitted to the transfer queue, and each
+// batch is identified by the transfer timeline value it signals. Only the
+// render thread may use the upload functions.
+auto createUploadContext(VkDeviceSize ringSize) -> void;
+auto destroyUploadContext() -> void;
+
+// Copies data into the ring right away and queues the transfer. Returns the
+// upload value after which the buffer contents may be used by draws. Blocks
+// only when the ring is full of copies still in flight.
+auto uploadBuffer(
+const Buffer& buffer, VkDeviceSize offset, const void* data,
+VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+-> uint64;
+
+// Submits the queued copies as one batch.
+auto submitUploads() -> void;
+// Records the barriers, and queue family ownership acquires, for every batch
+// that finished on the transfer queue. Work recorded after them may use the
+// uploaded data.
+auto acquireUploads(VkCommandBuffer commandBuffer) -> void;
+// Whether acquireUploads would record anything. A command buffer that
+// acquired uploads must not be submitted again.
+auto hasUploadsToAcquire() -> bool;
+auto isUploadComplete(uint64 value) -> bool;
+}
@@ -1,9 +1,57 @@
 #pragma once
 
-#include <vector>
+#include "utils/type.hpp"
+
+#include <future>
+#include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace sunset
 {
-    std::vector<char> readFile(std::string_view path);
+auto readFile(std::string_view path) -> std::vector<char>;
+// Writes to a temporary file next to path and renames it over path, so
+// readers never observe a partially written file.
+auto writeFileAtomic(std::string_view path, const std::vector<char>& data)
+-> void;
+
+// Read-only view of a whole file mapped into memory, so nothing is copied.
+// The OS is asked to start reading the file in right away, pages that are
+// not in yet fault in on first access. The view stays valid until the
+// MappedFile is destroyed.
+struct MappedFile
+{
+    MappedFile() = default;
+    explicit MappedFile(std::string_view path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Empty for an empty file.
+    auto getData() const -> std::span<const char>;
+
+private:
+    auto unmap() -> void;
+
+    const char* data = nullptr;
+    size_t      size = 0u;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+// Threads that serve asynchronous reads. Blocking on the disk in them keeps
+// the job system's workers free for rendering work.
+auto createFileReaders(uint32 threadCount) -> void;
+// Finishes the reads already queued first.
+auto destroyFileReaders() -> void;
+
+// Queues a read and returns right away. The future throws if the read failed.
+// Without file readers the file is read on the calling thread.
+auto readFileAsync(std::string path) -> std::future<std::vector<char>>;
+// Queues every read at once, in order, so readers pick them up together.
+auto readFilesAsync(std::span<const std::string> paths)
+-> std::vector<std::future<std::vector<char>>>;
 }
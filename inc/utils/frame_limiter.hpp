@@ -0,0 +1,25 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <chrono>
+
+namespace sunset
+{
+// Paces a loop to a target rate. Sleeps through most of the remaining time
+// and spins the rest, since a sleep can overshoot by a whole scheduler tick.
+struct FrameLimiter
+{
+    // 0 disables pacing.
+    auto setTargetRate(float64 framesPerSecond) -> void;
+    // Returns at the start of the next frame interval. A loop that fell
+    // behind continues right away rather than catching up in a burst.
+    auto wait() -> void;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration   interval{0};
+    Clock::time_point deadline;
+};
+}
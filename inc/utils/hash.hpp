@@ -0,0 +1,39 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+namespace sunset
+{
+constexpr uint64 fnvOffsetBasis = 14695981039346656037ull;
+constexpr uint64 fnvPrime       = 1099511628211ull;
+
+// 64-bit FNV-1a, chained through seed to hash several fields in sequence.
+inline auto hashBytes(
+const void* data, size_t size, uint64 seed = fnvOffsetBasis) -> uint64
+{
+    auto bytes = static_cast<const uint8*>(data);
+    auto hash  = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * fnvPrime;
+    }
+    return hash;
+}
+
+inline auto hashString(std::string_view str, uint64 seed = fnvOffsetBasis)
+-> uint64
+{
+    // Include the length so that consecutive strings cannot alias.
+    auto size = (uint64)str.size();
+    return hashBytes(
+    str.data(), str.size(), hashBytes(&size, sizeof(size), seed));
+}
+
+template <class T>
+auto hashValue(const T& value, uint64 seed = fnvOffsetBasis) -> uint64
+{
+    return hashBytes(&value, sizeof(value), seed);
+}
+}
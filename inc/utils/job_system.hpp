@@ -0,0 +1,254 @@
+#pragma once
+
+#include "utils/singleton.hpp"
+#include "utils/type.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sunset
+{
+// Resolves to one worker per hardware thread besides the calling one.
+constexpr uint32 autoWorkerCount = ~0u;
+
+// Number of jobs still to finish. Jobs increment it when they are queued and
+// decrement it when they complete, so a counter can both be waited on and
+// serve as the dependency of later jobs.
+struct JobCounter
+{
+    auto isDone() const -> bool
+    {
+        return value.load(std::memory_order_acquire) == 0u;
+    }
+
+    std::atomic<uint32> value{0u};
+};
+
+// Type erased callable stored inline, so queuing a job does not allocate.
+struct Job
+{
+    static constexpr size_t storageSize = 64u;
+
+    void (*invoke)(Job& job) = nullptr;
+    alignas(std::max_align_t) std::byte storage[storageSize];
+
+    JobCounter*       counter    = nullptr;
+    const JobCounter* dependency = nullptr;
+    std::atomic<bool> free{true};
+    // Jobs queued from outside the workers do not come from a job pool.
+    bool heapAllocated = false;
+};
+
+// Chase-Lev work-stealing deque of fixed capacity. The owning worker pushes
+// and pops at the bottom, any other thread steals from the top.
+struct JobDeque
+{
+    static constexpr int64 capacity = 4096;
+
+    auto push(Job* job) -> bool;
+    auto pop() -> Job*;
+    auto steal() -> Job*;
+
+    alignas(64) std::atomic<int64> top{0};
+    alignas(64) std::atomic<int64> bottom{0};
+    std::array<std::atomic<Job*>, capacity> jobs;
+};
+
+// Work-stealing scheduler. The thread calling start() becomes worker 0 and
+// only runs jobs while it waits; the other workers are background threads.
+// Waiting never blocks while there is work: the waiting thread runs queued
+// jobs, its own first and then stolen ones, until the wait is satisfied.
+// Long jobs go to a separate queue that only background workers take from,
+// so that worker 0 never picks one up in the middle of a frame.
+struct JobSystem : Singleton<JobSystem>
+{
+    friend Singleton;
+
+    auto start(uint32 workerCount = autoWorkerCount) -> void;
+    auto stop() -> void;
+
+    // Workers including the thread that called start().
+    auto getThreadCount() const -> uint32;
+
+    // Queues f, or runs it immediately when there are no background
+    // workers. f must not throw. It does not start before dependency, if
+    // given, is done.
+    template <class F>
+    auto run(
+    F&& f, JobCounter* counter = nullptr,
+    const JobCounter* dependency = nullptr) -> void;
+    // Like run, for jobs too long to run while waiting, such as pipeline
+    // compiles. Only background workers run them, after any other queued
+    // job.
+    template <class F>
+    auto runInBackground(F&& f, JobCounter* counter = nullptr) -> void;
+
+    auto wait(const JobCounter& counter) -> void;
+    // Runs other jobs until pred returns true.
+    template <class Pred>
+    auto waitUntil(Pred&& pred) -> void;
+
+    // Calls f(first, last) on subranges of [begin, end) no larger than grain
+    // and returns once all of them have finished. Ranges are split in halves
+    // so idle workers steal large pieces first.
+    template <class F>
+    auto parallelFor(uint64 begin, uint64 end, uint64 grain, F&& f) -> void;
+
+private:
+    JobSystem() = default;
+
+    static constexpr uint32 jobPoolSize = 4096u;
+
+    struct Worker
+    {
+        JobDeque                                      deque;
+        std::unique_ptr<std::array<Job, jobPoolSize>> jobPool;
+        uint32                                        nextJob = 0u;
+        std::thread                                   thread;
+    };
+
+    auto allocateJob() -> Job*;
+    template <class F>
+    auto createJob(
+    F&& f, JobCounter* counter, const JobCounter* dependency) -> Job*;
+    auto submit(Job* job) -> void;
+    auto submitInBackground(Job* job) -> void;
+    auto notifySleepingWorker() -> void;
+    // Runs a single queued job, returns false when none was found.
+    auto tryRunJob() -> bool;
+    auto findJob() -> Job*;
+    auto execute(Job* job) -> void;
+    auto workerLoop(uint32 index) -> void;
+
+    template <class F>
+    auto parallelForRange(
+    uint64 begin, uint64 end, uint64 grain, F& f, JobCounter& counter)
+    -> void;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Jobs queued from threads that are not workers.
+    std::mutex          injectMutex;
+    std::deque<Job*>    injectedJobs;
+    std::atomic<uint32> injectedCount{0u};
+
+    // Drained by background workers only, see runInBackground.
+    std::mutex          backgroundMutex;
+    std::deque<Job*>    backgroundJobs;
+    std::atomic<uint32> backgroundCount{0u};
+
+    std::mutex              sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<uint32>     sleepingWorkers{0u};
+    std::atomic<int64>      queuedJobs{0};
+    std::atomic<bool>       stopping{false};
+};
+
+template <class F>
+auto JobSystem::run(F&& f, JobCounter* counter, const JobCounter* dependency)
+-> void
+{
+    if (workers.size() <= 1) {
+        if (dependency != nullptr) {
+            waitUntil([&] { return dependency->isDone(); });
+        }
+        f();
+        return;
+    }
+
+    submit(createJob(std::forward<F>(f), counter, dependency));
+}
+
+template <class F>
+auto JobSystem::runInBackground(F&& f, JobCounter* counter) -> void
+{
+    if (workers.size() <= 1) {
+        f();
+        return;
+    }
+
+    submitInBackground(createJob(std::forward<F>(f), counter, nullptr));
+}
+
+template <class F>
+auto JobSystem::createJob(
+F&& f, JobCounter* counter, const JobCounter* dependency) -> Job*
+{
+    using Callable = std::decay_t<F>;
+    static_assert(
+    sizeof(Callable) <= Job::storageSize,
+    "Job captures too much state, capture a pointer instead.");
+    static_assert(alignof(Callable) <= alignof(std::max_align_t));
+
+    auto job = allocateJob();
+    new (job->storage) Callable(std::forward<F>(f));
+    job->invoke = [](Job& self) {
+        auto& callable = *std::launder(
+        reinterpret_cast<Callable*>(self.storage));
+        callable();
+        callable.~Callable();
+    };
+    job->counter    = counter;
+    job->dependency = dependency;
+
+    if (counter != nullptr) {
+        counter->value.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+template <class Pred>
+auto JobSystem::waitUntil(Pred&& pred) -> void
+{
+    uint32 idleSpins = 0u;
+    while (!pred()) {
+        if (tryRunJob()) {
+            idleSpins = 0u;
+        }
+        else if (++idleSpins > 64u) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <class F>
+auto JobSystem::parallelForRange(
+uint64 begin, uint64 end, uint64 grain, F& f, JobCounter& counter) -> void
+{
+    while (end - begin > grain) {
+        auto middle = begin + (end - begin) / 2;
+        run(
+        [this, middle, end, grain, &f, &counter] {
+            parallelForRange(middle, end, grain, f, counter);
+        },
+        &counter);
+        end = middle;
+    }
+
+    f(begin, end);
+}
+
+template <class F>
+auto JobSystem::parallelFor(uint64 begin, uint64 end, uint64 grain, F&& f)
+-> void
+{
+    if (begin >= end) {
+        return;
+    }
+
+    JobCounter counter;
+    parallelForRange(begin, end, grain == 0u ? 1u : grain, f, counter);
+    wait(counter);
+}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "utils/type.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace sunset
+{
+// Bump allocator over one fixed block. Deallocating is free and reset()
+// releases everything at once. Requests that do not fit are passed to the
+// upstream resource and counted, so the capacity can be tuned.
+struct LinearArena : std::pmr::memory_resource
+{
+    explicit LinearArena(
+    size_t                     capacity,
+    std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    LinearArena(const LinearArena&)            = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    // Everything allocated from the block becomes invalid.
+    auto reset() -> void;
+
+    auto getCapacity() const -> size_t;
+    auto getUsed() const -> size_t;
+    // Allocations since the last reset that went to the upstream resource.
+    auto getOverflowCount() const -> uint32;
+
+private:
+    auto do_allocate(size_t bytes, size_t alignment) -> void* override;
+    auto do_deallocate(void* p, size_t bytes, size_t alignment)
+    -> void override;
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept
+    -> bool override;
+
+    std::unique_ptr<std::byte[]> block;
+    size_t                       capacity;
+    size_t                       used          = 0u;
+    uint32                       overflowCount = 0u;
+    std::pmr::memory_resource*   upstream;
+};
+
+// Fixed size blocks carved out of chunks from the upstream resource and
+// recycled through a free list, for objects created and destroyed often.
+// Larger or more aligned requests go to the upstream resource directly.
+// Chunks are only returned when the pool is destroyed.
+struct PoolResource : std::pmr::memory_resource
+{
+    PoolResource(
+    size_t blockSize, size_t blocksPerChunk,
+    std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~PoolResource() override;
+
+    PoolResource(const PoolResource&)            = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    auto getBlockSize() const -> size_t;
+    auto getBlocksInUse() const -> size_t;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    auto do_allocate(size_t bytes, size_t alignment) -> void* override;
+    auto do_deallocate(void* p, size_t bytes, size_t alignment)
+    -> void override;
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept
+    -> bool override;
+
+    auto addChunk() -> void;
+
+    size_t                     blockSize;
+    size_t                     blocksPerChunk;
+    size_t                     blocksInUse = 0u;
+    FreeBlock*                 freeBlocks  = nullptr;
+    std::vector<std::byte*>    chunks;
+    std::pmr::memory_resource* upstream;
+};
+
+// Scratch memory for the render thread, reset at the start of every frame.
+// Nothing allocated from it may outlive the frame, or the setup call, that
+// allocated it.
+auto createFrameArena(size_t capacity) -> void;
+auto destroyFrameArena() -> void;
+auto getFrameArena() -> LinearArena&;
+
+// Heap allocations made through operator new by any thread so far. Only
+// counted in debug builds, always 0 otherwise.
+auto getHeapAllocationCount() -> uint64;
+}
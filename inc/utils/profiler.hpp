@@ -0,0 +1,95 @@
+#pragma once
+
+#include "utils/singleton.hpp"
+#include "utils/type.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sunset
+{
+struct ProfileEvent
+{
+    const char* name;
+    uint64      begin;  // Nanoseconds since the profiler was created.
+    uint64      end;
+    uint64      frame;
+};
+
+// Single producer ring of the most recent events of one thread. The owning
+// thread writes without locking; readers copy a snapshot and drop whatever the
+// writer may have overwritten while they were copying.
+struct ProfileEventRing
+{
+    static constexpr uint64 capacity = 16384u;
+
+    auto push(const ProfileEvent& event) -> void;
+    auto snapshot() const -> std::vector<ProfileEvent>;
+
+    std::array<ProfileEvent, capacity> events;
+    std::atomic<uint64>                head{0u};
+    uint32                             threadId;
+    std::string                        threadName;
+};
+
+struct Profiler : Singleton<Profiler>
+{
+    friend Singleton;
+
+    auto now() const -> uint64;
+
+    auto beginFrame(uint64 frame) -> void;
+    auto currentFrame() const -> uint64;
+
+    auto setThreadName(std::string_view name) -> void;
+    auto recordCpu(const char* name, uint64 begin, uint64 end) -> void;
+    // GPU events are reported by the render thread once their queries have
+    // been read back, already converted to the CPU time base.
+    auto recordGpu(const char* name, uint64 begin, uint64 end, uint64 frame)
+    -> void;
+
+    // Snapshots of every event still held in the rings, for tools that
+    // aggregate timings instead of exporting them.
+    auto cpuEvents() -> std::vector<ProfileEvent>;
+    auto gpuEvents() -> std::vector<ProfileEvent>;
+
+    // Writes everything still held in the rings as Chrome trace JSON, which
+    // chrome://tracing and Perfetto can both load.
+    auto writeChromeTrace(std::string_view path) -> void;
+
+private:
+    Profiler();
+
+    auto threadRing() -> ProfileEventRing&;
+
+    uint64              epoch;
+    std::atomic<uint64> frame{0u};
+
+    std::mutex                                     ringsMutex;
+    std::vector<std::unique_ptr<ProfileEventRing>> rings;
+    ProfileEventRing                               gpuRing;
+};
+
+struct ProfileZone
+{
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+
+    ProfileZone(const ProfileZone&)            = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64      begin;
+};
+
+#define PROFILE_CONCAT_IMPL(A, B) A##B
+#define PROFILE_CONCAT(A, B)      PROFILE_CONCAT_IMPL(A, B)
+#define PROFILE_ZONE(NAME) \
+    ::sunset::ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(NAME)
+}
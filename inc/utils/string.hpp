@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -19,12 +20,28 @@ concept StringType = requires() {
 }
 
 template <StringType String>
-auto toCStringArray(const std::vector<String>& strArray)
+auto toCStringArray(
+const std::vector<String>& strArray,
+std::pmr::memory_resource* resource = std::pmr::get_default_resource())
 {
-    std::vector<decltype(strArray.begin()->data())> cStrArray;
+    std::pmr::vector<decltype(strArray.begin()->data())> cStrArray(resource);
+    cStrArray.reserve(strArray.size());
     std::ranges::for_each(
     strArray, [&](const String& str) { cStrArray.push_back(str.data()); });
 
     return cStrArray;
 }
+
+// Whether every name is among the available items, getName returning the
+// name of an item. Quadratic, but the lists are short and nothing allocates.
+template <StringType String, class Range, class GetName>
+auto containsAllNames(
+const std::vector<String>& names, const Range& available, GetName getName)
+-> bool
+{
+    return std::ranges::all_of(names, [&](const String& name) {
+        return std::ranges::any_of(
+        available, [&](const auto& item) { return name == getName(item); });
+    });
+}
 }
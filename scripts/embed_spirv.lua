@@ -0,0 +1,26 @@
+-- Writes a SPIR-V module as a word array, see the embed_spirv rule in
+-- xmake.lua. Usage: xmake lua scripts/embed_spirv.lua <spv> <header> <symbol>
+function main(spvfile, headerfile, symbol)
+    local data = io.readfile(spvfile, {encoding = "binary"})
+    if #data == 0 or #data % 4 ~= 0 then
+        raise("%s is not a SPIR-V module", spvfile)
+    end
+
+    -- Words are stored little endian, as glslang writes them on every host
+    -- the engine runs on.
+    local lines = {}
+    local words = {}
+    for i = 1, #data, 4 do
+        local b0, b1, b2, b3 = data:byte(i, i + 3)
+        table.insert(words, string.format("0x%02x%02x%02x%02x", b3, b2, b1, b0))
+        if #words == 8 or i + 4 > #data then
+            table.insert(lines, "    " .. table.concat(words, ", ") .. ",")
+            words = {}
+        end
+    end
+
+    io.writefile(headerfile, string.format(
+        "// Generated from %s, do not edit.\n" ..
+        "alignas(4) constexpr uint32 %s[] = {\n%s\n};\n",
+        path.filename(spvfile), symbol, table.concat(lines, "\n")))
+end
@@ -1,20 +1,17 @@
 #version 450
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+// Offset in xyz, scale in w.
+layout(location = 2) in vec4 inInstance;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+layout(location = 0) out vec3 fragColor;
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+// The main pass tests for the depth the prepass wrote with EQUAL, both have
+// to compute the exact same position.
+invariant gl_Position;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    gl_Position = vec4(inPosition * inInstance.w + inInstance.xyz, 1.0);
+    fragColor = inColor;
 }
@@ -1,12 +1,69 @@
 #include "renderer/renderer.hpp"
 
+#include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
-int main()
+auto parseArgs(int argc, char** argv) -> sunset::RendererConfig
+{
+    sunset::RendererConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--frames-in-flight" && i + 1 < argc) {
+            config.framesInFlight = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--headless") {
+            config.headless = true;
+        }
+        else if (arg == "--frames" && i + 1 < argc) {
+            config.frameCount = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--trace" && i + 1 < argc) {
+            config.tracePath   = argv[++i];
+            config.traceOnExit = true;
+        }
+        else if (arg == "--width" && i + 1 < argc) {
+            config.width = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--height" && i + 1 < argc) {
+            config.height = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--present" && i + 1 < argc) {
+            std::string_view policy = argv[++i];
+            if (policy == "low-latency") {
+                config.presentPolicy = sunset::PresentPolicy::LowLatency;
+            }
+            else if (policy == "balanced") {
+                config.presentPolicy = sunset::PresentPolicy::Balanced;
+            }
+            else if (policy == "throughput") {
+                config.presentPolicy = sunset::PresentPolicy::Throughput;
+            }
+            else {
+                throw std::runtime_error(
+                "Unknown present policy " + std::string(policy));
+            }
+        }
+        else if (arg == "--fps" && i + 1 < argc) {
+            config.targetFrameRate = std::strtod(argv[++i], nullptr);
+        }
+        else {
+            throw std::runtime_error("Unknown argument " + std::string(arg));
+        }
+    }
+
+    return config;
+}
+
+int main(int argc, char** argv)
 {
     try {
-        sunset::Renderer::get().run();
+        sunset::Renderer::get().run(parseArgs(argc, argv));
     }
     catch (std::exception& e) {
         std::cerr << e.what() << std::endl;
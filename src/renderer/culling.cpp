@@ -0,0 +1,316 @@
+#include "renderer/culling.hpp"
+
+#include "utils/job_system.hpp"
+#include "utils/memory.hpp"
+#include "utils/profiler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <memory_resource>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SUNSET_CULL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// The file is built for the baseline CPU, the AVX2 kernel alone is compiled
+// for more and only called once the CPU is known to support it. MSVC accepts
+// the intrinsics without it.
+#if defined(SUNSET_CULL_X86) && !defined(_MSC_VER)
+#define SUNSET_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SUNSET_TARGET_AVX2
+#endif
+
+namespace sunset
+{
+namespace
+{
+// Below this many objects per job the hand-off costs more than the tests.
+constexpr size_t minObjectsPerJob = 4096u;
+
+// Writes the indices of the visible objects in [first, last) to visible and
+// returns how many there are.
+using CullRangeFn = size_t (*)(
+const CullBounds& bounds, const Frustum& frustum, size_t first, size_t last,
+uint32* visible);
+
+// Every kernel sums in this order, so that they agree on objects touching a
+// plane.
+auto isVisible(const CullBounds& bounds, const Frustum& frustum, size_t i)
+-> bool
+{
+    for (const auto& plane : frustum.planes) {
+        auto distance = plane.normal[0] * bounds.centerX[i] +
+                        plane.normal[1] * bounds.centerY[i] +
+                        plane.normal[2] * bounds.centerZ[i] + plane.distance;
+        auto boxRadius = std::abs(plane.normal[0]) * bounds.extentX[i] +
+                         std::abs(plane.normal[1]) * bounds.extentY[i] +
+                         std::abs(plane.normal[2]) * bounds.extentZ[i];
+        if (!(distance >= -std::min(bounds.radius[i], boxRadius))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+auto cullRangeScalar(
+const CullBounds& bounds, const Frustum& frustum, size_t first, size_t last,
+uint32* visible) -> size_t
+{
+    size_t count = 0u;
+    for (auto i = first; i < last; i++) {
+        if (isVisible(bounds, frustum, i)) {
+            visible[count++] = (uint32)i;
+        }
+    }
+
+    return count;
+}
+
+#ifdef SUNSET_CULL_X86
+auto appendVisible(uint32 mask, size_t base, uint32* visible, size_t& count)
+-> void
+{
+    while (mask != 0u) {
+        visible[count++] = (uint32)(base + std::countr_zero(mask));
+        mask &= mask - 1u;
+    }
+}
+
+auto cullRangeSse(
+const CullBounds& bounds, const Frustum& frustum, size_t first, size_t last,
+uint32* visible) -> size_t
+{
+    size_t count = 0u;
+    auto   i     = first;
+    for (; i + 4u <= last; i += 4u) {
+        auto centerX = _mm_loadu_ps(&bounds.centerX[i]);
+        auto centerY = _mm_loadu_ps(&bounds.centerY[i]);
+        auto centerZ = _mm_loadu_ps(&bounds.centerZ[i]);
+        auto radius  = _mm_loadu_ps(&bounds.radius[i]);
+        auto extentX = _mm_loadu_ps(&bounds.extentX[i]);
+        auto extentY = _mm_loadu_ps(&bounds.extentY[i]);
+        auto extentZ = _mm_loadu_ps(&bounds.extentZ[i]);
+
+        auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            auto distance = _mm_add_ps(
+            _mm_add_ps(
+            _mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(plane.normal[0]), centerX),
+            _mm_mul_ps(_mm_set1_ps(plane.normal[1]), centerY)),
+            _mm_mul_ps(_mm_set1_ps(plane.normal[2]), centerZ)),
+            _mm_set1_ps(plane.distance));
+            auto boxRadius = _mm_add_ps(
+            _mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(std::abs(plane.normal[0])), extentX),
+            _mm_mul_ps(_mm_set1_ps(std::abs(plane.normal[1])), extentY)),
+            _mm_mul_ps(_mm_set1_ps(std::abs(plane.normal[2])), extentZ));
+            auto limit =
+            _mm_sub_ps(_mm_setzero_ps(), _mm_min_ps(radius, boxRadius));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, limit));
+        }
+
+        appendVisible((uint32)_mm_movemask_ps(inside), i, visible, count);
+    }
+
+    return count +
+           cullRangeScalar(bounds, frustum, i, last, visible + count);
+}
+
+SUNSET_TARGET_AVX2 auto cullRangeAvx2(
+const CullBounds& bounds, const Frustum& frustum, size_t first, size_t last,
+uint32* visible) -> size_t
+{
+    size_t count = 0u;
+    auto   i     = first;
+    for (; i + 8u <= last; i += 8u) {
+        auto centerX = _mm256_loadu_ps(&bounds.centerX[i]);
+        auto centerY = _mm256_loadu_ps(&bounds.centerY[i]);
+        auto centerZ = _mm256_loadu_ps(&bounds.centerZ[i]);
+        auto radius  = _mm256_loadu_ps(&bounds.radius[i]);
+        auto extentX = _mm256_loadu_ps(&bounds.extentX[i]);
+        auto extentY = _mm256_loadu_ps(&bounds.extentY[i]);
+        auto extentZ = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+        auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& plane : frustum.planes) {
+            auto distance = _mm256_add_ps(
+            _mm256_add_ps(
+            _mm256_add_ps(
+            _mm256_mul_ps(_mm256_set1_ps(plane.normal[0]), centerX),
+            _mm256_mul_ps(_mm256_set1_ps(plane.normal[1]), centerY)),
+            _mm256_mul_ps(_mm256_set1_ps(plane.normal[2]), centerZ)),
+            _mm256_set1_ps(plane.distance));
+            auto boxRadius = _mm256_add_ps(
+            _mm256_add_ps(
+            _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.normal[0])), extentX),
+            _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.normal[1])), extentY)),
+            _mm256_mul_ps(_mm256_set1_ps(std::abs(plane.normal[2])), extentZ));
+            auto limit = _mm256_sub_ps(
+            _mm256_setzero_ps(), _mm256_min_ps(radius, boxRadius));
+            inside = _mm256_and_ps(
+            inside, _mm256_cmp_ps(distance, limit, _CMP_GE_OQ));
+        }
+
+        appendVisible((uint32)_mm256_movemask_ps(inside), i, visible, count);
+    }
+
+    return count +
+           cullRangeScalar(bounds, frustum, i, last, visible + count);
+}
+#endif
+
+auto detectCullKernel() -> CullKernel
+{
+#if defined(SUNSET_CULL_X86) && defined(_MSC_VER)
+    // AVX2 also needs the OS to save the YMM registers.
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        auto osxsave = (info[2] & (1 << 27)) != 0;
+        auto avx     = (info[2] & (1 << 28)) != 0;
+        __cpuidex(info, 7, 0);
+        auto avx2 = (info[1] & (1 << 5)) != 0;
+        if (osxsave && avx && avx2 && (_xgetbv(0) & 6u) == 6u) {
+            return CullKernel::Avx2;
+        }
+    }
+    return CullKernel::Sse;
+#elif defined(SUNSET_CULL_X86)
+    if (__builtin_cpu_supports("avx2")) {
+        return CullKernel::Avx2;
+    }
+    return CullKernel::Sse;
+#else
+    return CullKernel::Scalar;
+#endif
+}
+
+auto getCullRange(CullKernel kernel) -> CullRangeFn
+{
+    // Never wider than the CPU supports.
+    if ((uint32)kernel > (uint32)getCullKernel()) {
+        kernel = getCullKernel();
+    }
+
+    switch (kernel) {
+#ifdef SUNSET_CULL_X86
+        case CullKernel::Avx2:
+            return cullRangeAvx2;
+        case CullKernel::Sse:
+            return cullRangeSse;
+#endif
+        default:
+            return cullRangeScalar;
+    }
+}
+}
+
+auto getClipSpaceFrustum() -> Frustum
+{
+    Frustum frustum;
+    // x >= -1, x <= 1, y >= -1, y <= 1, z >= 0, z <= 1.
+    frustum.planes[0] = {{1.0f, 0.0f, 0.0f}, 1.0f};
+    frustum.planes[1] = {{-1.0f, 0.0f, 0.0f}, 1.0f};
+    frustum.planes[2] = {{0.0f, 1.0f, 0.0f}, 1.0f};
+    frustum.planes[3] = {{0.0f, -1.0f, 0.0f}, 1.0f};
+    frustum.planes[4] = {{0.0f, 0.0f, 1.0f}, 0.0f};
+    frustum.planes[5] = {{0.0f, 0.0f, -1.0f}, 1.0f};
+
+    return frustum;
+}
+
+auto CullBounds::resize(size_t count) -> void
+{
+    for (auto field :
+         {&centerX, &centerY, &centerZ, &radius, &extentX, &extentY,
+          &extentZ}) {
+        field->resize(count);
+    }
+}
+
+auto CullBounds::size() const -> size_t { return radius.size(); }
+
+auto CullBounds::set(
+size_t index, const float32 center[3], float32 sphereRadius,
+const float32 extents[3]) -> void
+{
+    centerX[index] = center[0];
+    centerY[index] = center[1];
+    centerZ[index] = center[2];
+    radius[index]  = sphereRadius;
+    extentX[index] = extents[0];
+    extentY[index] = extents[1];
+    extentZ[index] = extents[2];
+}
+
+auto getCullKernel() -> CullKernel
+{
+    static const auto kernel = detectCullKernel();
+    return kernel;
+}
+
+auto getCullKernelName(CullKernel kernel) -> const char*
+{
+    switch (kernel) {
+        case CullKernel::Scalar:
+            return "scalar";
+        case CullKernel::Sse:
+            return "sse";
+        case CullKernel::Avx2:
+            return "avx2";
+    }
+
+    return "unknown";
+}
+
+auto cullBounds(
+const CullBounds& bounds, const Frustum& frustum, std::vector<uint32>& visible,
+CullKernel kernel) -> void
+{
+    PROFILE_ZONE("Cull draws");
+
+    auto cullRange = getCullRange(kernel);
+    auto count     = bounds.size();
+    visible.resize(count);
+
+    auto& jobSystem  = JobSystem::get();
+    auto  chunkCount = std::min<size_t>(
+    (count + minObjectsPerJob - 1) / minObjectsPerJob,
+    jobSystem.getThreadCount());
+    if (chunkCount <= 1u) {
+        visible.resize(cullRange(bounds, frustum, 0u, count, visible.data()));
+        return;
+    }
+
+    // Each chunk writes to the start of its own range of visible.
+    auto                     chunkSize = (count + chunkCount - 1) / chunkCount;
+    std::pmr::vector<size_t> chunkVisible(chunkCount, &getFrameArena());
+    jobSystem.parallelFor(0u, chunkCount, 1u, [&](uint64 first, uint64 last) {
+        for (auto chunk = first; chunk != last; chunk++) {
+            auto begin = std::min(chunk * chunkSize, count);
+            auto end   = std::min(begin + chunkSize, count);
+            chunkVisible[chunk] =
+            cullRange(bounds, frustum, begin, end, visible.data() + begin);
+        }
+    });
+
+    // Close the gaps, moving indices down only.
+    auto total = chunkVisible[0];
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        auto begin = visible.begin() + std::min(chunk * chunkSize, count);
+        std::copy(
+        begin, begin + chunkVisible[chunk], visible.begin() + total);
+        total += chunkVisible[chunk];
+    }
+    visible.resize(total);
+}
+}
@@ -1,34 +1,167 @@
 #include "renderer/renderer.hpp"
 
+#include "renderer/vulkan/allocator.hpp"
 #include "renderer/vulkan/command.hpp"
+#include "renderer/vulkan/deletion_queue.hpp"
 #include "renderer/vulkan/device.hpp"
 #include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/gpu_profiler.hpp"
+#include "renderer/vulkan/gpu_scene.hpp"
 #include "renderer/vulkan/pipeline.hpp"
+#include "renderer/vulkan/pipeline_cache.hpp"
+#include "renderer/vulkan/pipeline_registry.hpp"
+#include "renderer/vulkan/recorder.hpp"
 #include "renderer/vulkan/instance.hpp"
+#include "renderer/vulkan/instancing.hpp"
+#include "renderer/vulkan/mesh.hpp"
+#include "renderer/vulkan/offscreen.hpp"
+#include "renderer/vulkan/render_graph.hpp"
 #include "renderer/vulkan/render_pass.hpp"
+#include "renderer/vulkan/shader_compiler.hpp"
 #include "renderer/vulkan/surface.hpp"
 #include "renderer/vulkan/swapchain.hpp"
+#include "renderer/vulkan/timeline.hpp"
+#include "renderer/vulkan/upload.hpp"
+#include "utils/file.hpp"
+#include "utils/memory.hpp"
+#include "utils/profiler.hpp"
 
 #include <GLFW/glfw3.h>
 
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <numeric>
 #include <stdexcept>
+#include <utility>
 
 namespace sunset
 {
-auto Renderer::run() -> void
+auto Renderer::run(const RendererConfig& rendererConfig) -> void
 {
-    initWindow();
-    initVulkan();
+    init(rendererConfig);
     mainLoop();
+    if (config.traceOnExit) {
+        writeTrace();
+    }
+    shutdown();
+}
+
+auto Renderer::init(const RendererConfig& rendererConfig) -> void
+{
+    config = rendererConfig;
+    if (config.framesInFlight == 0) {
+        throw std::runtime_error("At least one frame in flight is required.");
+    }
+
+    Profiler::get().setThreadName("Render");
+    JobSystem::get().start(config.workerThreadCount);
+    createFrameArena(config.frameArenaSize);
+    createFileReaders(config.fileReaderThreadCount);
+    createShaderCompiler(config.shaderCachePath);
+    frameLimiter.setTargetRate(config.targetFrameRate);
+
+    if (!config.headless) {
+        initWindow();
+    }
+    initVulkan();
+}
+
+auto Renderer::waitIdle() -> void { vkDeviceWaitIdle(device); }
+
+auto Renderer::shutdown() -> void
+{
+    waitIdle();
     cleanUp();
+    destroyShaderCompiler();
+    destroyFrameArena();
+    destroyFileReaders();
+    JobSystem::get().stop();
+}
+
+auto Renderer::setDrawItems(const std::vector<DrawItem>& items) -> void
+{
+    draws = buildInstancedDraws(items);
+    updateDrawBounds();
+    sceneVersion++;
+    if (config.gpuDriven && setGpuSceneDraws(draws)) {
+        buildRenderGraph();
+    }
+}
+
+auto Renderer::getDrawCount() const -> size_t { return draws.size(); }
+
+auto Renderer::getVisibleDrawCount() const -> std::optional<size_t>
+{
+    // Culled on the GPU, the counts are never read back.
+    if (config.gpuDriven) {
+        return std::nullopt;
+    }
+    return visibleDraws.size();
+}
+
+auto Renderer::setCullFrustum(const Frustum& frustum) -> void
+{
+    cullFrustum = frustum;
+    if (config.gpuDriven) {
+        setGpuCullFrustum(frustum);
+    }
+    sceneVersion++;
+}
+
+auto Renderer::invalidateCommandBuffers() -> void { sceneVersion++; }
+
+auto Renderer::reloadShaders() -> void
+{
+    reloadPipelines();
+    invalidateCommandBuffers();
+}
+
+auto Renderer::getFrameNumber() const -> uint64 { return frameNumber; }
+
+auto Renderer::setPresentPolicy(PresentPolicy policy) -> void
+{
+    config.presentPolicy = policy;
+    if (!config.headless) {
+        swapchainOutOfDate = true;
+    }
+}
+
+auto Renderer::setTargetFrameRate(float64 framesPerSecond) -> void
+{
+    config.targetFrameRate = framesPerSecond;
+    frameLimiter.setTargetRate(framesPerSecond);
+}
+
+auto Renderer::getLatencyMs() const -> float64 { return latencyMs; }
+
+auto Renderer::getFrameHeapAllocations() const -> uint64
+{
+    return frameHeapAllocations;
+}
+
+auto Renderer::getRenderGraphStats() const -> const RenderGraphStats&
+{
+    return renderGraph.getStats();
 }
 
 auto Renderer::initWindow() -> void
 {
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-    window = glfwCreateWindow(width, height, "Sunset Engine", nullptr, nullptr);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    window = glfwCreateWindow(
+    config.width, config.height, "Sunset Engine", nullptr, nullptr);
+
+    glfwSetKeyCallback(
+    window, [](GLFWwindow*, int key, int, int action, int) {
+        if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+            Renderer::get().traceRequested = true;
+        }
+    });
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int, int) {
+        Renderer::get().swapchainOutOfDate = true;
+    });
 }
 
 auto getGLFWRequiredInstanceExtensions() -> std::vector<std::string>
@@ -46,14 +179,15 @@ auto getGLFWRequiredInstanceExtensions() -> std::vector<std::string>
 
 auto Renderer::initVulkan() -> void
 {
-    int width, height;
-    glfwGetFramebufferSize(window, &width, &height);
-
     std::vector<std::string> instanceEnabledExtensions;
-    auto glfwRequiredInstanceExtensions = getGLFWRequiredInstanceExtensions();
-    instanceEnabledExtensions.insert(
-    instanceEnabledExtensions.end(), glfwRequiredInstanceExtensions.begin(),
-    glfwRequiredInstanceExtensions.end());
+    if (!config.headless) {
+        auto glfwRequiredInstanceExtensions =
+        getGLFWRequiredInstanceExtensions();
+        instanceEnabledExtensions.insert(
+        instanceEnabledExtensions.end(),
+        glfwRequiredInstanceExtensions.begin(),
+        glfwRequiredInstanceExtensions.end());
+    }
 #ifdef DEBUG
     instanceEnabledExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
@@ -64,20 +198,61 @@ auto Renderer::initVulkan() -> void
 #endif
 
     std::vector<std::string> deviceEnabledExtensions;
-    deviceEnabledExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    if (!config.headless) {
+        deviceEnabledExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     std::vector<std::string> deviceEnabledLayers;
 #ifdef DEBUG
     deviceEnabledLayers.push_back("VK_LAYER_KHRONOS_validation");
 #endif
 
+    prefetchPipelineCache(config.pipelineCachePath);
     createInstance(instanceEnabledExtensions, instanceEnabledLayers);
-    createGLFWSurface(window);
-    createDevice(deviceEnabledExtensions, deviceEnabledLayers);
-    createSwapchain(width, height);
+    if (config.headless) {
+        createDevice(deviceEnabledExtensions, deviceEnabledLayers);
+        createAllocator();
+        createPipelineCache(config.pipelineCachePath);
+        createOffscreenTargets(
+        config.width, config.height, config.framesInFlight);
+    }
+    else {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+
+        createGLFWSurface(window);
+        createDevice(deviceEnabledExtensions, deviceEnabledLayers);
+        createAllocator();
+        createPipelineCache(config.pipelineCachePath);
+        createSwapchain(width, height, config.presentPolicy);
+    }
+    createTimelines();
+    createDeletionQueue();
+    createPipelineRegistry();
     createGraphicsPipeline();
+    if (config.depthPrepass) {
+        // Like the default pipeline, these have to be ready to draw anything.
+        for (auto variant :
+             {PipelineVariant::DepthPrepass, PipelineVariant::DepthEqual}) {
+            waitForPipeline(getPipelineVariant(getDefaultPipeline(), variant));
+        }
+    }
+    config.gpuDriven = config.gpuDriven && isMultiDrawIndirectEnabled();
+    if (config.gpuDriven) {
+        createGpuScene();
+        setGpuCullFrustum(cullFrustum);
+    }
+    buildRenderGraph();
     createCommandPool();
-    createCommandBuffer();
+    createUploadContext(config.uploadRingSize);
+    createMeshes();
+    draws = buildInstancedDraws({DrawItem{}});
+    updateDrawBounds();
+    if (config.gpuDriven && setGpuSceneDraws(draws)) {
+        buildRenderGraph();
+    }
+    createFrameCommandBuffers();
+    createGpuProfiler(config.framesInFlight);
     createSyncObjs();
 }
 
@@ -86,69 +261,474 @@ auto Renderer::createSyncObjs() -> void
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    frames.resize(config.framesInFlight);
+    for (auto& frame : frames) {
+        if (
+        vkCreateSemaphore(
+        device, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) !=
+        VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan semaphores!");
+        }
+    }
 
-    if (
-    vkCreateSemaphore(
-    device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-    vkCreateSemaphore(
-    device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
-    vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create Vulkan semaphores!");
+    if (!config.headless) {
+        createRenderFinishedSemaphores();
+    }
+}
+
+auto Renderer::createRenderFinishedSemaphores() -> void
+{
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    renderFinishedSemaphores.resize(swapchainImages.size());
+    for (auto& semaphore : renderFinishedSemaphores) {
+        if (
+        vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) !=
+        VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan semaphores!");
+        }
+    }
+}
+
+auto Renderer::destroySyncObjs() -> void
+{
+    for (auto& frame : frames) {
+        vkDestroySemaphore(device, frame.imageAvailableSemaphore, nullptr);
+    }
+    frames.clear();
+
+    for (auto semaphore : renderFinishedSemaphores) {
+        vkDestroySemaphore(device, semaphore, nullptr);
+    }
+    renderFinishedSemaphores.clear();
+}
+
+auto Renderer::createFrameCommandBuffers() -> void
+{
+    auto imageCount = (uint32)swapchainImages.size();
+    createCommandBuffers(config.framesInFlight * imageCount);
+    createDrawRecorder(config.framesInFlight, imageCount);
+    recordedCommands.assign(config.framesInFlight * imageCount, {});
+}
+
+auto Renderer::destroyFrameCommandBuffers() -> void
+{
+    destroyDrawRecorder();
+    destroyCommandBuffers();
+    recordedCommands.clear();
+}
+
+auto Renderer::buildRenderGraph() -> void
+{
+    // Frames in flight keep executing the previous graph.
+    auto previousGraph = std::make_shared<RenderGraph>(std::move(renderGraph));
+    deferDestroy([previousGraph] { previousGraph->destroy(); });
+    renderGraph = {};
+
+    ImportedImageDesc backbufferDesc{};
+    backbufferDesc.format      = swapchainImageFormat;
+    backbufferDesc.extent      = swapchainExtent;
+    backbufferDesc.images      = swapchainImages;
+    backbufferDesc.views       = swapchainImageViews;
+    backbufferDesc.finalLayout = swapchainImageLayout;
+    // Acquire semaphores are waited on in this stage.
+    backbufferDesc.initialStages =
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    auto backbuffer = renderGraph.importImage("Backbuffer", backbufferDesc);
+
+    // Sized with the swapchain, the graph creates it again on resize.
+    auto depth = renderGraph.createImage(
+    "Depth", RenderImageDesc{depthFormat, swapchainExtent});
+
+    // Draws in a pass are recorded on the CPU, or culled on the GPU first and
+    // drawn indirectly.
+    GpuCullOutputs cullOutputs{};
+    if (config.gpuDriven) {
+        cullOutputs = addGpuCullPasses(renderGraph);
+    }
+    auto addDrawPass = [&](const char* name, PipelineVariant variant) {
+        auto pass = renderGraph.addPass(name, PassType::Graphics);
+        if (config.gpuDriven) {
+            pass.read(cullOutputs.commands, ResourceUsage::IndirectRead)
+            .read(cullOutputs.counts, ResourceUsage::IndirectRead)
+            .setExecute([variant](const PassContext& context) {
+                return recordGpuSceneDraws(context, variant);
+            });
+        }
+        else {
+            pass
+            .setContents(
+            [this] { return getDrawContents(visibleDraws.size()); })
+            .setExecute([this, variant](const PassContext& context) {
+                return recordDraws(context, draws, visibleDraws, variant);
+            });
+        }
+        return pass;
+    };
+
+    VkClearDepthStencilValue depthClear{1.0f, 0u};
+    auto                     variant = PipelineVariant::Default;
+    if (config.depthPrepass) {
+        addDrawPass("Depth prepass", PipelineVariant::DepthPrepass)
+        .writeDepth(depth, depthClear);
+        variant = PipelineVariant::DepthEqual;
+    }
+
+    auto mainPass = addDrawPass("Main pass", variant);
+    mainPass.writeColor(
+    backbuffer, VkClearColorValue{{0.0f, 0.0f, 0.0f, 1.0f}});
+    if (config.depthPrepass) {
+        mainPass.readDepth(depth);
+    }
+    else {
+        mainPass.writeDepth(depth, depthClear);
+    }
+
+    renderGraph.markOutput(backbuffer);
+    renderGraph.compile();
+    if (config.gpuDriven) {
+        bindGpuCullOutputs(renderGraph, cullOutputs);
+    }
+}
+
+auto Renderer::updateDrawBounds() -> void
+{
+    drawBounds.resize(draws.size());
+    for (size_t i = 0; i < draws.size(); i++) {
+        const auto& bounds = draws[i].bounds;
+        drawBounds.set(i, bounds.center, bounds.radius, draws[i].extents);
+    }
+}
+
+auto Renderer::cullDraws() -> void
+{
+    if (culledVersion == sceneVersion) {
+        return;
     }
+
+    if (config.frustumCulling) {
+        cullBounds(drawBounds, cullFrustum, visibleDraws);
+    }
+    else {
+        visibleDraws.resize(draws.size());
+        std::iota(visibleDraws.begin(), visibleDraws.end(), 0u);
+    }
+    culledVersion = sceneVersion;
 }
 
+auto Renderer::recreateSwapchain() -> bool
+{
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+
+    // A minimized window has nothing to present to, keep the old swapchain
+    // until it is restored.
+    if (width == 0 || height == 0) {
+        return false;
+    }
+
+    PROFILE_ZONE("Recreate swapchain");
+
+    // Frames in flight keep using the old objects, they are destroyed once
+    // the first submission to the new swapchain has completed rather than
+    // after a device wait. Presenting the old images was queued before it.
+    deferDestroy(
+    Timeline::Graphics, getSubmittedValue(Timeline::Graphics) + 1,
+    [oldSwapchain = swapchain, imageViews = std::move(swapchainImageViews),
+     semaphores = std::move(renderFinishedSemaphores)] {
+        for (auto imageView : imageViews) {
+            vkDestroyImageView(device, imageView, nullptr);
+        }
+        for (auto semaphore : semaphores) {
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+        vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+    });
+
+    auto imageCount = swapchainImages.size();
+    createSwapchain(width, height, config.presentPolicy);
+    buildRenderGraph();
+    createRenderFinishedSemaphores();
+
+    // Command buffers exist per swapchain image. The image count hardly
+    // ever changes, so waiting for the frames in flight is acceptable then.
+    if (swapchainImages.size() != imageCount) {
+        waitForValue(Timeline::Graphics, getSubmittedValue(Timeline::Graphics));
+
+        destroyFrameCommandBuffers();
+        createFrameCommandBuffers();
+    }
+
+    // Every recorded command buffer references an old framebuffer.
+    invalidateCommandBuffers();
+    swapchainOutOfDate = false;
+
+    return true;
+}
 
 auto Renderer::mainLoop() -> void
 {
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+    using Clock = std::chrono::steady_clock;
+
+    auto   start     = Clock::now();
+    auto   fpsStart  = start;
+    auto   lastSave  = start;
+    uint32 fpsFrames = 0u;
+
+    while (!shouldClose()) {
+        {
+            PROFILE_ZONE("Frame limiter");
+            frameLimiter.wait();
+        }
+
+        // Input is sampled after the limiter so that its wait does not add
+        // to the latency of the frame.
+        if (!config.headless) {
+            PROFILE_ZONE("Poll events");
+            glfwPollEvents();
+        }
+        inputTime = Profiler::get().now();
         drawFrame();
+
+        if (traceRequested) {
+            writeTrace();
+            traceRequested = false;
+        }
+
+        auto sinceSave = std::chrono::duration<float64>(Clock::now() - lastSave);
+        if (sinceSave.count() >= config.pipelineCacheSaveIntervalSecs) {
+            PROFILE_ZONE("Save pipeline cache");
+            savePipelineCache();
+            lastSave = Clock::now();
+        }
+
+        ++fpsFrames;
+        auto elapsed = std::chrono::duration<float64>(Clock::now() - fpsStart);
+        if (!config.headless && elapsed.count() >= 1.0) {
+            char title[96];
+            std::snprintf(
+            title, sizeof(title), "Sunset Engine - %.1f fps, %.2f ms latency",
+            fpsFrames / elapsed.count(), latencyMs);
+            glfwSetWindowTitle(window, title);
+
+            fpsStart  = Clock::now();
+            fpsFrames = 0u;
+        }
     }
 
-    vkDeviceWaitIdle(device);
+    if (config.headless) {
+        auto elapsed = std::chrono::duration<float64>(Clock::now() - start);
+        std::printf(
+        "Rendered %llu frames in %.3f s (%.1f fps, %.2f ms latency)\n",
+        (unsigned long long)frameNumber, elapsed.count(),
+        frameNumber / elapsed.count(), latencyMs);
+
+        const auto& graphStats = renderGraph.getStats();
+        std::printf(
+        "Render graph: %u passes, %u culled, %u barrier batches, %llu KiB "
+        "transient memory for %llu KiB of images\n",
+        graphStats.passCount, graphStats.culledPassCount,
+        graphStats.barrierBatchCount,
+        (unsigned long long)graphStats.transientMemoryBytes / 1024u,
+        (unsigned long long)graphStats.transientImageBytes / 1024u);
+        if (auto visible = getVisibleDrawCount()) {
+            std::printf(
+            "Draws: %zu of %zu visible, %s culling kernel\n", *visible,
+            draws.size(), getCullKernelName(getCullKernel()));
+        }
+        else {
+            std::printf("Draws: %zu, culled on the GPU\n", draws.size());
+        }
+#ifdef DEBUG
+        std::printf(
+        "Heap allocations in the last frame: %llu\n",
+        (unsigned long long)frameHeapAllocations);
+#endif
+    }
 }
 
-auto Renderer::drawFrame() -> void
+auto Renderer::shouldClose() -> bool
+{
+    if (config.frameCount != 0 && frameNumber >= config.frameCount) {
+        return true;
+    }
+
+    return !config.headless && glfwWindowShouldClose(window);
+}
+
+auto Renderer::acquireImage(Frame& frame) -> std::optional<uint32>
+{
+    // Offscreen targets are allocated one per frame in flight, so waiting for
+    // the slot's previous frame already guarantees the image is not in use.
+    if (config.headless) {
+        return currentFrame;
+    }
+
+    uint32 imageIndex;
+    auto   result = vkAcquireNextImageKHR(
+    device, swapchain, UINT64_MAX, frame.imageAvailableSemaphore,
+    VK_NULL_HANDLE, &imageIndex);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        swapchainOutOfDate = true;
+        return std::nullopt;
+    }
+
+    // A suboptimal swapchain can still be presented to, it is replaced
+    // after this frame.
+    if (result == VK_SUBOPTIMAL_KHR) {
+        swapchainOutOfDate = true;
+    }
+    else if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to acquire swapchain image.");
+    }
+
+    return imageIndex;
+}
+
+auto Renderer::prepareCommandBuffer(uint32 imageIndex) -> VkCommandBuffer
 {
-    vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(device, 1, &inFlightFence);
+    auto  index         = currentFrame * swapchainImages.size() + imageIndex;
+    auto  commandBuffer = commandBuffers[index];
+    auto& recorded      = recordedCommands[index];
 
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(
-    device, swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE,
-    &imageIndex);
+    // Pending uploads have to be acquired by a freshly recorded buffer.
+    if (
+    config.reuseCommandBuffers && recorded.sceneVersion == sceneVersion &&
+    !hasUploadsToAcquire()) {
+        setGpuZones(recorded.gpuZones);
+        return commandBuffer;
+    }
+
+    PROFILE_ZONE("Record command buffer");
+
+    if (!config.gpuDriven) {
+        cullDraws();
+    }
 
     vkResetCommandBuffer(commandBuffer, 0);
-    recordCommandBuffer(commandBuffer, imageIndex);
+    auto reusable = recordCommandBuffer(
+    commandBuffer, renderGraph, currentFrame, imageIndex);
 
+    recorded.sceneVersion = reusable ? sceneVersion : ~0ull;
+    // Assigning keeps the capacity, recording again does not allocate.
+    auto gpuZones = getGpuZones();
+    recorded.gpuZones.assign(gpuZones.begin(), gpuZones.end());
+
+    return commandBuffer;
+}
+
+auto Renderer::drawFrame() -> void
+{
+    // Counted from one frame to the next, so the loop around drawFrame is
+    // included.
+    auto heapAllocations = getHeapAllocationCount();
+    frameHeapAllocations = heapAllocations - lastHeapAllocations;
+    lastHeapAllocations  = heapAllocations;
+    getFrameArena().reset();
+
+    if (swapchainOutOfDate && !recreateSwapchain()) {
+        // Minimized, sleep until the window changes instead of spinning.
+        glfwWaitEvents();
+        return;
+    }
+
+    auto& profiler   = Profiler::get();
+    auto  frameStart = profiler.now();
+    profiler.beginFrame(frameNumber);
+    PROFILE_ZONE("Frame");
+
+    auto& frame = frames[currentFrame];
+
+    {
+        PROFILE_ZONE("Wait for frame");
+        waitForValue(Timeline::Graphics, frame.submitValue);
+    }
+    auto frameCompleted = profiler.now();
+
+    collectDeletions();
+    collectInstanceBuffers();
+
+    std::optional<uint32> acquired;
+    {
+        PROFILE_ZONE("Acquire image");
+        acquired = acquireImage(frame);
+    }
+
+    // Nothing was submitted for the slot, so the frame is simply retried once
+    // the swapchain has been recreated.
+    if (!acquired) {
+        return;
+    }
+    auto imageIndex = *acquired;
+
+    beginGpuProfilerFrame(currentFrame, frameNumber);
+    updateLatency(frame, frameCompleted);
+    frame.inputTime = inputTime != 0u ? inputTime : frameStart;
+    inputTime       = 0u;
+    submitUploads();
+
+    auto commandBuffer = prepareCommandBuffer(imageIndex);
+
+    PROFILE_ZONE("Submit and present");
+
+    submitInfo       = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore          waitSemaphores[] = {imageAvailableSemaphore};
+    VkSemaphore          waitSemaphores[] = {frame.imageAvailableSemaphore};
     VkPipelineStageFlags waitStages[]     = {
     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores    = waitSemaphores;
-    submitInfo.pWaitDstStageMask  = waitStages;
-
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers    = &commandBuffer;
 
-    VkSemaphore signalSemaphores[]  = {renderFinishedSemaphore};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores    = signalSemaphores;
+    if (!config.headless) {
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores    = waitSemaphores;
+        submitInfo.pWaitDstStageMask  = waitStages;
 
-    if (
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
-        throw std::runtime_error(
-        "Failed to submit Vulkan draw command buffer.");
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &renderFinishedSemaphores[imageIndex];
+    }
+
+    frame.submitValue = submitToTimeline(Timeline::Graphics, submitInfo);
+
+    presentImage(imageIndex);
+
+    currentFrame = (currentFrame + 1) % config.framesInFlight;
+    ++frameNumber;
+}
+
+auto Renderer::updateLatency(const Frame& frame, uint64 frameCompleted) -> void
+{
+    if (frame.inputTime == 0u) {
+        return;
+    }
+
+    // GPU timestamps tell when the slot's previous frame finished, without
+    // them the wait for it returning is the closest bound.
+    auto finished = getGpuFrameEnd();
+    if (finished == 0u) {
+        finished = frameCompleted;
+    }
+    if (finished <= frame.inputTime) {
+        return;
+    }
+
+    auto sampleMs = (finished - frame.inputTime) / 1e6;
+    latencyMs     = latencyMs == 0.0 ? sampleMs
+                                     : latencyMs * 0.9 + sampleMs * 0.1;
+}
+
+auto Renderer::presentImage(uint32 imageIndex) -> void
+{
+    if (config.headless) {
+        return;
     }
 
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores    = signalSemaphores;
+    presentInfo.pWaitSemaphores    = &renderFinishedSemaphores[imageIndex];
 
     VkSwapchainKHR swapChains[] = {swapchain};
     presentInfo.swapchainCount  = 1;
@@ -156,19 +736,50 @@ auto Renderer::drawFrame() -> void
     presentInfo.pImageIndices   = &imageIndex;
     presentInfo.pResults        = nullptr;
 
-    vkQueuePresentKHR(presentQueue, &presentInfo);
+    auto result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        swapchainOutOfDate = true;
+    }
+    else if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to present swapchain image.");
+    }
+}
+
+auto Renderer::writeTrace() -> void
+{
+    Profiler::get().writeChromeTrace(config.tracePath);
+    std::printf("Wrote trace to %s\n", config.tracePath.c_str());
 }
 
 auto Renderer::cleanUp() -> void
 {
-    vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-    vkDestroyFence(device, inFlightFence, nullptr);
+    destroyDeletionQueue();
+    destroySyncObjs();
 
-    destroyCommandBuffer();
+    destroyGpuProfiler();
+    destroyFrameCommandBuffers();
+    if (config.gpuDriven) {
+        destroyGpuScene();
+    }
+    destroyInstances();
+    destroyMeshes();
+    destroyUploadContext();
     destroyCommandPool();
+    destroyPipelineRegistry();
+    renderGraph.destroy();
     destroyGraphicsPipeline();
+    destroyPipelineCache();
+    destroyTimelines();
+    if (config.headless) {
+        destroyOffscreenTargets();
+        destroyAllocator();
+        destroyDevice();
+        destroyInstance();
+        return;
+    }
+
     destroySwapchain();
+    destroyAllocator();
     destroyDevice();
     destroySurface();
     destroyInstance();
@@ -0,0 +1,658 @@
+#include "renderer/vulkan/allocator.hpp"
+
+#include "renderer/vulkan/global.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace sunset
+{
+namespace
+{
+constexpr uint32       slBits             = 5u;
+constexpr uint32       slCount            = 1u << slBits;
+constexpr uint32       flCount            = 64u;
+constexpr uint32       invalidNode        = ~0u;
+constexpr VkDeviceSize preferredBlockSize = 64ull << 20;
+
+auto alignUp(VkDeviceSize value, VkDeviceSize alignment) -> VkDeviceSize
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+auto alignDown(VkDeviceSize value, VkDeviceSize alignment) -> VkDeviceSize
+{
+    return value / alignment * alignment;
+}
+
+// Size classes: the first level is the power of two below the size, the
+// second splits each power of two into slCount linear steps.
+auto mapping(VkDeviceSize size) -> std::pair<uint32, uint32>
+{
+    uint32 fl = 63u - std::countl_zero(size);
+    uint32 sl = fl >= slBits ? uint32(size >> (fl - slBits)) - slCount
+                             : uint32(size << (slBits - fl)) - slCount;
+    return {fl, sl};
+}
+
+class TlsfAllocator
+{
+public:
+    explicit TlsfAllocator(VkDeviceSize size)
+    {
+        for (auto& heads : freeHeads) {
+            heads.fill(invalidNode);
+        }
+
+        nodes.push_back(
+        {0, size, invalidNode, invalidNode, invalidNode, invalidNode, true});
+        insertFree(0);
+    }
+
+    auto allocate(VkDeviceSize size, VkDeviceSize alignment) -> uint32
+    {
+        // Round the request up to the next size class so that any free range
+        // found in it is large enough, including the worst alignment padding.
+        auto searchSize = size + alignment - 1;
+        auto fl         = mapping(searchSize).first;
+        if (fl > slBits) {
+            searchSize += (1ull << (fl - slBits)) - 1;
+        }
+
+        auto node = findFree(searchSize);
+        if (node == invalidNode) {
+            return invalidNode;
+        }
+        removeFree(node);
+
+        auto offset  = nodes[node].offset;
+        auto padding = alignUp(offset, alignment) - offset;
+        if (padding > 0) {
+            auto front = splitFront(node, padding);
+            insertFree(front);
+        }
+
+        if (nodes[node].size > size) {
+            auto back = splitBack(node, size);
+            insertFree(back);
+        }
+
+        nodes[node].free = false;
+        return node;
+    }
+
+    auto free(uint32 node) -> void
+    {
+        nodes[node].free = true;
+
+        auto next = nodes[node].nextPhysical;
+        if (next != invalidNode && nodes[next].free) {
+            removeFree(next);
+            merge(node, next);
+        }
+
+        auto prev = nodes[node].prevPhysical;
+        if (prev != invalidNode && nodes[prev].free) {
+            removeFree(prev);
+            merge(prev, node);
+            node = prev;
+        }
+
+        insertFree(node);
+    }
+
+    auto getOffset(uint32 node) const -> VkDeviceSize
+    {
+        return nodes[node].offset;
+    }
+
+private:
+    struct Node
+    {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint32       prevPhysical;
+        uint32       nextPhysical;
+        uint32       prevFree;
+        uint32       nextFree;
+        bool         free;
+    };
+
+    auto createNode(VkDeviceSize offset, VkDeviceSize size) -> uint32
+    {
+        Node node = {
+        offset, size, invalidNode, invalidNode, invalidNode, invalidNode, true};
+
+        if (!unusedNodes.empty()) {
+            auto index = unusedNodes.back();
+            unusedNodes.pop_back();
+            nodes[index] = node;
+            return index;
+        }
+
+        nodes.push_back(node);
+        return nodes.size() - 1;
+    }
+
+    // Carves the first size bytes off node into a new node placed before it.
+    auto splitFront(uint32 node, VkDeviceSize size) -> uint32
+    {
+        auto front = createNode(nodes[node].offset, size);
+        auto prev  = nodes[node].prevPhysical;
+
+        nodes[front].prevPhysical = prev;
+        nodes[front].nextPhysical = node;
+        if (prev != invalidNode) {
+            nodes[prev].nextPhysical = front;
+        }
+
+        nodes[node].prevPhysical = front;
+        nodes[node].offset += size;
+        nodes[node].size -= size;
+
+        return front;
+    }
+
+    // Shrinks node to size bytes and returns a new node for the rest.
+    auto splitBack(uint32 node, VkDeviceSize size) -> uint32
+    {
+        auto back = createNode(
+        nodes[node].offset + size, nodes[node].size - size);
+        auto next = nodes[node].nextPhysical;
+
+        nodes[back].prevPhysical = node;
+        nodes[back].nextPhysical = next;
+        if (next != invalidNode) {
+            nodes[next].prevPhysical = back;
+        }
+
+        nodes[node].nextPhysical = back;
+        nodes[node].size         = size;
+
+        return back;
+    }
+
+    // Absorbs next, which must directly follow node in memory.
+    auto merge(uint32 node, uint32 next) -> void
+    {
+        auto after = nodes[next].nextPhysical;
+
+        nodes[node].size += nodes[next].size;
+        nodes[node].nextPhysical = after;
+        if (after != invalidNode) {
+            nodes[after].prevPhysical = node;
+        }
+
+        unusedNodes.push_back(next);
+    }
+
+    auto insertFree(uint32 node) -> void
+    {
+        auto [fl, sl] = mapping(nodes[node].size);
+        auto head     = freeHeads[fl][sl];
+
+        nodes[node].prevFree = invalidNode;
+        nodes[node].nextFree = head;
+        if (head != invalidNode) {
+            nodes[head].prevFree = node;
+        }
+
+        freeHeads[fl][sl] = node;
+        flBitmap |= 1ull << fl;
+        slBitmaps[fl] |= 1u << sl;
+    }
+
+    auto removeFree(uint32 node) -> void
+    {
+        auto [fl, sl] = mapping(nodes[node].size);
+        auto prev     = nodes[node].prevFree;
+        auto next     = nodes[node].nextFree;
+
+        if (prev != invalidNode) {
+            nodes[prev].nextFree = next;
+        }
+        else {
+            freeHeads[fl][sl] = next;
+        }
+
+        if (next != invalidNode) {
+            nodes[next].prevFree = prev;
+        }
+
+        if (freeHeads[fl][sl] == invalidNode) {
+            slBitmaps[fl] &= ~(1u << sl);
+            if (slBitmaps[fl] == 0) {
+                flBitmap &= ~(1ull << fl);
+            }
+        }
+    }
+
+    auto findFree(VkDeviceSize size) -> uint32
+    {
+        auto [fl, sl] = mapping(size);
+
+        uint32 slMap = slBitmaps[fl] & (~0u << sl);
+        if (slMap == 0) {
+            uint64 flMap = fl + 1 < flCount ? flBitmap & (~0ull << (fl + 1))
+                                            : 0;
+            if (flMap == 0) {
+                return invalidNode;
+            }
+
+            fl    = std::countr_zero(flMap);
+            slMap = slBitmaps[fl];
+        }
+
+        return freeHeads[fl][std::countr_zero(slMap)];
+    }
+
+    std::vector<Node>                                nodes;
+    std::vector<uint32>                              unusedNodes;
+    std::array<std::array<uint32, slCount>, flCount> freeHeads;
+    std::array<uint32, flCount>                      slBitmaps = {};
+    uint64                                           flBitmap  = 0;
+};
+}
+
+struct MemoryBlock
+{
+    VkDeviceMemory memory;
+    VkDeviceSize   size;
+    uint32         memoryType;
+    uint32         pool;
+    void*          mapped;
+    // Null for dedicated allocations, which hold a single resource.
+    std::unique_ptr<TlsfAllocator> tlsf;
+    uint32                         allocationCount;
+};
+
+namespace
+{
+VkPhysicalDeviceMemoryProperties memoryProperties;
+VkDeviceSize                     bufferImageGranularity;
+VkDeviceSize                     nonCoherentAtomSize;
+uint32                           maxMemoryAllocationCount;
+
+std::mutex allocatorMutex;
+// Indexed by memory type * 2 + 1 for optimal tiling images.
+std::vector<std::vector<std::unique_ptr<MemoryBlock>>> pools;
+std::vector<std::unique_ptr<MemoryBlock>>              dedicatedBlocks;
+std::vector<MemoryStats>                               heapStats;
+uint32                                                 liveMemoryCount;
+// Across every heap. Heaps peak at different times, so the total peak is
+// not the sum of theirs.
+uint64 totalBlockBytes;
+uint64 peakTotalBlockBytes;
+
+auto isCoherent(uint32 memoryType) -> bool
+{
+    return memoryProperties.memoryTypes[memoryType].propertyFlags &
+           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+auto isHostVisible(uint32 memoryType) -> bool
+{
+    return memoryProperties.memoryTypes[memoryType].propertyFlags &
+           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+auto getHeapStats(uint32 memoryType) -> MemoryStats&
+{
+    return heapStats[memoryProperties.memoryTypes[memoryType].heapIndex];
+}
+
+auto chooseMemoryType(uint32 typeFilter, MemoryUsage usage) -> uint32
+{
+    VkMemoryPropertyFlags required  = 0;
+    VkMemoryPropertyFlags preferred = 0;
+
+    switch (usage) {
+    case MemoryUsage::GpuOnly:
+        required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        break;
+    case MemoryUsage::CpuToGpu:
+        required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        break;
+    case MemoryUsage::GpuToCpu:
+        required  = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        break;
+    }
+
+    for (uint32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        auto flags = memoryProperties.memoryTypes[i].propertyFlags;
+        if (
+        (typeFilter & (1u << i)) &&
+        (flags & (required | preferred)) == (required | preferred)) {
+            return i;
+        }
+    }
+
+    return findMemoryType(typeFilter, required);
+}
+
+auto getBlockSize(uint32 memoryType) -> VkDeviceSize
+{
+    auto heapIndex = memoryProperties.memoryTypes[memoryType].heapIndex;
+    auto heapSize  = memoryProperties.memoryHeaps[heapIndex].size;
+
+    auto size = heapSize <= (1ull << 30) ? heapSize / 8 : preferredBlockSize;
+    return alignUp(size, nonCoherentAtomSize);
+}
+
+auto allocateBlock(VkDeviceSize size, uint32 memoryType, uint32 pool)
+-> std::unique_ptr<MemoryBlock>
+{
+    if (liveMemoryCount >= maxMemoryAllocationCount) {
+        throw std::runtime_error("Exceeded maxMemoryAllocationCount.");
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize  = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    auto block        = std::make_unique<MemoryBlock>();
+    block->size       = size;
+    block->memoryType = memoryType;
+    block->pool       = pool;
+    block->mapped     = nullptr;
+
+    if (
+    vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate Vulkan device memory.");
+    }
+
+    if (
+    isHostVisible(memoryType) &&
+    vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) !=
+    VK_SUCCESS) {
+        vkFreeMemory(device, block->memory, nullptr);
+        throw std::runtime_error("Failed to map Vulkan device memory.");
+    }
+
+    liveMemoryCount++;
+
+    auto& stats = getHeapStats(memoryType);
+    stats.blockCount++;
+    stats.blockBytes += size;
+    stats.peakBlockBytes = std::max(stats.peakBlockBytes, stats.blockBytes);
+    totalBlockBytes += size;
+    peakTotalBlockBytes = std::max(peakTotalBlockBytes, totalBlockBytes);
+
+    return block;
+}
+
+auto freeBlock(MemoryBlock& block) -> void
+{
+    // Freeing the memory implicitly unmaps it.
+    vkFreeMemory(device, block.memory, nullptr);
+    liveMemoryCount--;
+
+    auto& stats = getHeapStats(block.memoryType);
+    stats.blockCount--;
+    stats.blockBytes -= block.size;
+    totalBlockBytes -= block.size;
+}
+
+auto getMappedRange(
+const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+-> VkMappedMemoryRange
+{
+    auto begin = allocation.offset + offset;
+    auto end   = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size
+                                       : begin + size;
+
+    // Blocks are sized in whole atoms and non-coherent suballocations are
+    // atom aligned, so the expanded range never touches a neighbour.
+    VkMappedMemoryRange range{};
+    range.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = alignDown(begin, nonCoherentAtomSize);
+    range.size   = std::min(
+    alignUp(end, nonCoherentAtomSize), allocation.block->size) -
+    range.offset;
+
+    return range;
+}
+}
+
+auto createAllocator() -> void
+{
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    bufferImageGranularity   = properties.limits.bufferImageGranularity;
+    nonCoherentAtomSize      = properties.limits.nonCoherentAtomSize;
+    maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+    pools.resize(memoryProperties.memoryTypeCount * 2);
+    heapStats.assign(memoryProperties.memoryHeapCount, {});
+    liveMemoryCount     = 0u;
+    totalBlockBytes     = 0u;
+    peakTotalBlockBytes = 0u;
+}
+
+auto destroyAllocator() -> void
+{
+    for (auto& pool : pools) {
+        for (auto& block : pool) {
+            freeBlock(*block);
+        }
+    }
+
+    for (auto& block : dedicatedBlocks) {
+        freeBlock(*block);
+    }
+
+    pools.clear();
+    dedicatedBlocks.clear();
+    heapStats.clear();
+}
+
+auto findMemoryType(uint32 typeFilter, VkMemoryPropertyFlags properties)
+-> uint32
+{
+    for (uint32 i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if (
+        (typeFilter & (1u << i)) &&
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+        properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable Vulkan memory type.");
+}
+
+auto allocateMemory(
+const VkMemoryRequirements& requirements, MemoryUsage usage, bool linear)
+-> Allocation
+{
+    auto memoryType = chooseMemoryType(requirements.memoryTypeBits, usage);
+
+    auto size      = requirements.size;
+    auto alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+    if (isHostVisible(memoryType) && !isCoherent(memoryType)) {
+        size      = alignUp(size, nonCoherentAtomSize);
+        alignment = std::max(alignment, nonCoherentAtomSize);
+    }
+
+    // With a granularity of 1 linear and optimal resources may share pages.
+    auto pool = memoryType * 2;
+    if (!linear && bufferImageGranularity > 1) {
+        pool++;
+    }
+
+    std::lock_guard lock(allocatorMutex);
+
+    Allocation allocation;
+    allocation.size       = requirements.size;
+    allocation.memoryType = memoryType;
+
+    auto blockSize = getBlockSize(memoryType);
+    if (size > blockSize / 2) {
+        dedicatedBlocks.push_back(allocateBlock(
+        alignUp(size, nonCoherentAtomSize), memoryType, pool));
+        allocation.block = dedicatedBlocks.back().get();
+    }
+    else {
+        for (auto& block : pools[pool]) {
+            auto node = block->tlsf->allocate(size, alignment);
+            if (node != invalidNode) {
+                allocation.block  = block.get();
+                allocation.node   = node;
+                allocation.offset = block->tlsf->getOffset(node);
+                break;
+            }
+        }
+
+        if (allocation.block == nullptr) {
+            auto block  = allocateBlock(blockSize, memoryType, pool);
+            block->tlsf = std::make_unique<TlsfAllocator>(blockSize);
+
+            allocation.block  = block.get();
+            allocation.node   = block->tlsf->allocate(size, alignment);
+            allocation.offset = block->tlsf->getOffset(allocation.node);
+
+            pools[pool].push_back(std::move(block));
+        }
+    }
+
+    allocation.block->allocationCount++;
+    allocation.memory = allocation.block->memory;
+    if (allocation.block->mapped != nullptr) {
+        allocation.mapped = static_cast<char*>(allocation.block->mapped) +
+                            allocation.offset;
+    }
+
+    auto& stats = getHeapStats(memoryType);
+    stats.allocationCount++;
+    stats.allocatedBytes += allocation.size;
+
+    return allocation;
+}
+
+auto freeMemory(Allocation& allocation) -> void
+{
+    if (allocation.block == nullptr) {
+        return;
+    }
+
+    std::lock_guard lock(allocatorMutex);
+
+    auto& stats = getHeapStats(allocation.memoryType);
+    stats.allocationCount--;
+    stats.allocatedBytes -= allocation.size;
+
+    auto block = allocation.block;
+    block->allocationCount--;
+
+    if (block->tlsf == nullptr) {
+        freeBlock(*block);
+        std::erase_if(dedicatedBlocks, [&](const auto& dedicated) {
+            return dedicated.get() == block;
+        });
+    }
+    else {
+        block->tlsf->free(allocation.node);
+
+        // Keep one empty block per pool around so that a resource being
+        // recreated does not free and reallocate a whole block.
+        auto& pool = pools[block->pool];
+        if (block->allocationCount == 0 && pool.size() > 1) {
+            freeBlock(*block);
+            std::erase_if(pool, [&](const auto& pooled) {
+                return pooled.get() == block;
+            });
+        }
+    }
+
+    allocation = {};
+}
+
+auto allocateBufferMemory(VkBuffer buffer, MemoryUsage usage) -> Allocation
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+
+    auto allocation = allocateMemory(requirements, usage, true);
+    if (
+    vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) !=
+    VK_SUCCESS) {
+        freeMemory(allocation);
+        throw std::runtime_error("Failed to bind Vulkan buffer memory.");
+    }
+
+    return allocation;
+}
+
+auto allocateImageMemory(
+VkImage image, VkImageTiling tiling, MemoryUsage usage) -> Allocation
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image, &requirements);
+
+    auto allocation = allocateMemory(
+    requirements, usage, tiling == VK_IMAGE_TILING_LINEAR);
+    if (
+    vkBindImageMemory(device, image, allocation.memory, allocation.offset) !=
+    VK_SUCCESS) {
+        freeMemory(allocation);
+        throw std::runtime_error("Failed to bind Vulkan image memory.");
+    }
+
+    return allocation;
+}
+
+auto flushAllocation(
+const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) -> void
+{
+    if (isCoherent(allocation.memoryType)) {
+        return;
+    }
+
+    auto range = getMappedRange(allocation, offset, size);
+    vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+auto invalidateAllocation(
+const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) -> void
+{
+    if (isCoherent(allocation.memoryType)) {
+        return;
+    }
+
+    auto range = getMappedRange(allocation, offset, size);
+    vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+auto getAllocatorStats() -> AllocatorStats
+{
+    std::lock_guard lock(allocatorMutex);
+
+    AllocatorStats stats;
+    stats.heaps = heapStats;
+
+    for (const auto& heap : heapStats) {
+        stats.total.blockCount += heap.blockCount;
+        stats.total.blockBytes += heap.blockBytes;
+        stats.total.allocationCount += heap.allocationCount;
+        stats.total.allocatedBytes += heap.allocatedBytes;
+    }
+    stats.total.peakBlockBytes = peakTotalBlockBytes;
+
+    return stats;
+}
+}
@@ -0,0 +1,51 @@
+#include "renderer/vulkan/buffer.hpp"
+
+#include "renderer/vulkan/global.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+
+namespace sunset
+{
+auto createBuffer(
+VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage)
+-> Buffer
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size        = size;
+    bufferInfo.usage       = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    Buffer buffer;
+    buffer.size = size;
+
+    if (
+    vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan buffer.");
+    }
+
+    try {
+        buffer.allocation = allocateBufferMemory(buffer.buffer, memoryUsage);
+    }
+    catch (...) {
+        vkDestroyBuffer(device, buffer.buffer, nullptr);
+        throw;
+    }
+
+    return buffer;
+}
+
+auto destroyBuffer(Buffer& buffer) -> void
+{
+    if (buffer.buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkDestroyBuffer(device, buffer.buffer, nullptr);
+    freeMemory(buffer.allocation);
+    buffer = {};
+}
+}
@@ -1,7 +1,10 @@
 #include "renderer/vulkan/command.hpp"
 
 #include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/gpu_profiler.hpp"
 #include "renderer/vulkan/queue.hpp"
+#include "renderer/vulkan/timeline.hpp"
+#include "renderer/vulkan/upload.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -25,23 +28,26 @@ auto createCommandPool() -> void
     }
 }
 
-auto createCommandBuffer() -> void
+auto createCommandBuffers(uint32 count) -> void
 {
+    commandBuffers.resize(count);
+
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool = commandPool;
     allocInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
+    allocInfo.commandBufferCount = count;
 
     if (
-    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) !=
+    vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) !=
     VK_SUCCESS) {
         throw std::runtime_error("failed to allocate command buffers!");
     }
 }
 
-auto recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex)
--> void
+auto recordCommandBuffer(
+VkCommandBuffer commandBuffer, RenderGraph& graph, uint32 frameIndex,
+uint32 imageIndex) -> bool
 {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -52,36 +58,60 @@ auto recordCommandBuffer(VkCommandBuffer commandBuffer, uint32 imageIndex)
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass        = renderPass;
-    renderPassInfo.framebuffer       = swapchainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapchainExtent;
+    resetGpuZones(commandBuffer);
+    auto frameZone = beginGpuZone(commandBuffer, "Frame");
+    auto reusable  = !hasUploadsToAcquire();
+    acquireUploads(commandBuffer);
 
-    VkClearValue clearColor        = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues    = &clearColor;
+    if (!graph.execute(commandBuffer, frameIndex, imageIndex)) {
+        reusable = false;
+    }
+    endGpuZone(commandBuffer, frameZone);
 
-    vkCmdBeginRenderPass(
-    commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(
-    commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record Vulkan command buffer!");
+    }
 
-    viewport.width  = swapchainExtent.width;
-    viewport.height = swapchainExtent.height;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    return reusable;
+}
 
-    scissor.extent = swapchainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+auto beginOneTimeCommands() -> VkCommandBuffer
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
 
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    VkCommandBuffer commandBuffer;
+    if (
+    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate Vulkan command buffer.");
+    }
 
-    vkCmdEndRenderPass(commandBuffer);
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to record Vulkan command buffer!");
-    }
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    return commandBuffer;
+}
+
+auto endOneTimeCommands(VkCommandBuffer commandBuffer) -> void
+{
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &commandBuffer;
+
+    auto value = submitToTimeline(Timeline::Graphics, submitInfo);
+    waitForValue(Timeline::Graphics, value);
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
 auto destroyCommandPool() -> void
@@ -89,5 +119,10 @@ auto destroyCommandPool() -> void
     vkDestroyCommandPool(device, commandPool, nullptr);
 }
 
-auto destroyCommandBuffer() -> void {}
+auto destroyCommandBuffers() -> void
+{
+    vkFreeCommandBuffers(
+    device, commandPool, (uint32)commandBuffers.size(), commandBuffers.data());
+    commandBuffers.clear();
+}
 }
@@ -0,0 +1,91 @@
+#include "renderer/vulkan/deletion_queue.hpp"
+
+#include "utils/profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <utility>
+
+namespace sunset
+{
+namespace
+{
+struct Deletion
+{
+    uint64                value;
+    std::function<void()> destroy;
+};
+
+// Sorted by value, so collecting stops at the first entry still in use.
+std::array<std::deque<Deletion>, timelineCount> queues;
+
+auto getQueue(Timeline timeline) -> std::deque<Deletion>&
+{
+    return queues[(uint32)timeline];
+}
+}
+
+auto createDeletionQueue() -> void
+{
+    for (auto& queue : queues) {
+        queue.clear();
+    }
+}
+
+auto destroyDeletionQueue() -> void
+{
+    for (uint32 i = 0; i < timelineCount; i++) {
+        auto timeline = (Timeline)i;
+        waitForValue(timeline, getSubmittedValue(timeline));
+
+        // Values past the last submission are never going to be used.
+        for (auto& deletion : queues[i]) {
+            deletion.destroy();
+        }
+        queues[i].clear();
+    }
+}
+
+auto deferDestroy(
+Timeline timeline, uint64 value, std::function<void()> destroy) -> void
+{
+    if (isValueComplete(timeline, value)) {
+        destroy();
+        return;
+    }
+
+    auto& queue    = getQueue(timeline);
+    auto  position = std::upper_bound(
+    queue.begin(), queue.end(), value,
+    [](uint64 key, const Deletion& deletion) { return key < deletion.value; });
+    queue.insert(position, Deletion{value, std::move(destroy)});
+}
+
+auto deferDestroy(std::function<void()> destroy) -> void
+{
+    deferDestroy(
+    Timeline::Graphics, getSubmittedValue(Timeline::Graphics),
+    std::move(destroy));
+}
+
+auto collectDeletions() -> void
+{
+    PROFILE_ZONE("Collect deletions");
+
+    for (uint32 i = 0; i < timelineCount; i++) {
+        auto& queue = queues[i];
+        if (queue.empty()) {
+            continue;
+        }
+
+        auto completed = getCompletedValue((Timeline)i);
+        while (!queue.empty() && queue.front().value <= completed) {
+            // Destroy may defer more, take the entry out first.
+            auto deletion = std::move(queue.front());
+            queue.pop_front();
+            deletion.destroy();
+        }
+    }
+}
+}
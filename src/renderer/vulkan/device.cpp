@@ -1,8 +1,10 @@
 #include "renderer/vulkan/device.hpp"
 
 #include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/instance.hpp"
 #include "renderer/vulkan/queue.hpp"
 #include "renderer/vulkan/swapchain.hpp"
+#include "utils/memory.hpp"
 #include "utils/string.hpp"
 #include "utils/type.hpp"
 
@@ -14,6 +16,39 @@
 
 namespace sunset
 {
+namespace
+{
+bool timelineSemaphoreEnabled = false;
+bool drawIndirectCountEnabled = false;
+bool multiDrawIndirectEnabled = false;
+
+// Features that are core in 1.2, none are supported before.
+auto queryVulkan12Features(VkPhysicalDevice device)
+-> VkPhysicalDeviceVulkan12Features
+{
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType =
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    if (
+    getInstanceApiVersion() < VK_API_VERSION_1_2 ||
+    properties.apiVersion < VK_API_VERSION_1_2) {
+        return vulkan12Features;
+    }
+
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    vulkan12Features.pNext = nullptr;
+    return vulkan12Features;
+}
+}
+
 auto queryDeviceExtensionSupport(
 VkPhysicalDevice device, const std::vector<std::string>& extensionNames) -> bool
 {
@@ -21,18 +56,14 @@ VkPhysicalDevice device, const std::vector<std::string>& extensionNames) -> bool
     vkEnumerateDeviceExtensionProperties(
     device, nullptr, &extensionCount, nullptr);
 
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    std::pmr::vector<VkExtensionProperties> availableExtensions(
+    extensionCount, &getFrameArena());
     vkEnumerateDeviceExtensionProperties(
     device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensionNames(
-    extensionNames.begin(), extensionNames.end());
-
-    for (const auto& availableExtension : availableExtensions) {
-        requiredExtensionNames.erase(availableExtension.extensionName);
-    }
-
-    return requiredExtensionNames.empty();
+    return containsAllNames(
+    extensionNames, availableExtensions,
+    [](const auto& extension) { return extension.extensionName; });
 }
 
 auto queryDeviceLayerSupport(
@@ -41,23 +72,24 @@ VkPhysicalDevice device, const std::vector<std::string>& layerNames) -> bool
     uint32 layerCount;
     vkEnumerateDeviceLayerProperties(device, &layerCount, nullptr);
 
-    std::vector<VkLayerProperties> availableLayers(layerCount);
+    std::pmr::vector<VkLayerProperties> availableLayers(
+    layerCount, &getFrameArena());
     vkEnumerateDeviceLayerProperties(
     device, &layerCount, availableLayers.data());
 
-    std::set<std::string> requiredLayerNames(
-    layerNames.begin(), layerNames.end());
-
-    for (const auto& availableLayer : availableLayers) {
-        requiredLayerNames.erase(availableLayer.layerName);
-    }
-
-    return requiredLayerNames.empty();
+    return containsAllNames(layerNames, availableLayers, [](const auto& layer) {
+        return layer.layerName;
+    });
 }
 
 auto querySwapChainSupport(VkPhysicalDevice device) -> bool
 {
-    auto swapchainDetails = getSwapchainSupportDetails(device);
+    if (surface == VK_NULL_HANDLE) {
+        return true;
+    }
+
+    auto swapchainDetails = getSwapchainSupportDetails(
+    device, &getFrameArena());
     return !swapchainDetails.formats.empty() &&
            !swapchainDetails.presentModes.empty();
 }
@@ -110,6 +142,10 @@ const std::vector<std::string>& layerNames) -> void
     indices.graphicsFamily.value(), indices.presentFamily.value()};
     float queuePriority = 1.0f;
 
+    if (indices.transferFamily.has_value()) {
+        queueFamilyIndices.insert(indices.transferFamily.value());
+    }
+
     for (auto queueFamilyIndex : queueFamilyIndices) {
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -120,8 +156,8 @@ const std::vector<std::string>& layerNames) -> void
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    auto extensionNamesC = toCStringArray(extensionNames);
-    auto layerNamesC     = toCStringArray(layerNames);
+    auto extensionNamesC = toCStringArray(extensionNames, &getFrameArena());
+    auto layerNamesC     = toCStringArray(layerNames, &getFrameArena());
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -136,6 +172,21 @@ const std::vector<std::string>& layerNames) -> void
     vkGetPhysicalDeviceFeatures(physicalDevice, &features);
     createInfo.pEnabledFeatures = &features;
 
+    multiDrawIndirectEnabled = features.multiDrawIndirect == VK_TRUE;
+
+    auto supported           = queryVulkan12Features(physicalDevice);
+    timelineSemaphoreEnabled = supported.timelineSemaphore == VK_TRUE;
+    drawIndirectCountEnabled = supported.drawIndirectCount == VK_TRUE;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType =
+    VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = supported.timelineSemaphore;
+    vulkan12Features.drawIndirectCount = supported.drawIndirectCount;
+    if (timelineSemaphoreEnabled || drawIndirectCountEnabled) {
+        createInfo.pNext = &vulkan12Features;
+    }
+
     if (
     vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) !=
     VK_SUCCESS) {
@@ -144,6 +195,12 @@ const std::vector<std::string>& layerNames) -> void
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+    transferQueue = graphicsQueue;
+    if (indices.transferFamily.has_value()) {
+        vkGetDeviceQueue(
+        device, indices.transferFamily.value(), 0, &transferQueue);
+    }
 }
 
 auto createDevice(
@@ -155,4 +212,34 @@ const std::vector<std::string>& layerNames) -> void
 }
 
 auto destroyDevice() -> void { vkDestroyDevice(device, nullptr); }
+
+auto isTimelineSemaphoreEnabled() -> bool { return timelineSemaphoreEnabled; }
+
+auto isDrawIndirectCountEnabled() -> bool { return drawIndirectCountEnabled; }
+
+auto isMultiDrawIndirectEnabled() -> bool { return multiDrawIndirectEnabled; }
+
+auto findDepthFormat() -> VkFormat
+{
+    // Without stencil first, nothing uses it. D16 has too little precision
+    // for large scenes, it is only the last resort.
+    constexpr VkFormat candidates[] = {
+    VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32,
+    VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT,
+    VK_FORMAT_D16_UNORM};
+
+    for (auto format : candidates) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(
+        physicalDevice, format, &properties);
+
+        if (
+        properties.optimalTilingFeatures &
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("No supported Vulkan depth format.");
+}
 }
@@ -0,0 +1,29 @@
+#include "renderer/vulkan/embedded_shaders.hpp"
+
+#include <array>
+
+namespace sunset
+{
+namespace
+{
+struct EmbeddedShader
+{
+    std::string_view        name;
+    std::span<const uint32> code;
+};
+
+// Generated, defines every shader's words and lists them in embeddedShaders.
+#include "embedded_shaders.inc"
+}
+
+auto findEmbeddedShader(std::string_view name) -> std::span<const uint32>
+{
+    for (const auto& shader : embeddedShaders) {
+        if (shader.name == name) {
+            return shader.code;
+        }
+    }
+
+    return {};
+}
+}
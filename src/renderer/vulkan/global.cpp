@@ -14,22 +14,26 @@ VkPhysicalDevice physicalDevice;
 VkDevice         device;
 VkQueue          graphicsQueue;
 VkQueue          presentQueue;
+VkQueue          transferQueue;
 
 VkSwapchainKHR   swapchain;
 std::vector<VkImage> swapchainImages;
 std::vector<VkImageView> swapchainImageViews;
-std::vector<VkFramebuffer> swapchainFramebuffers;
 VkFormat swapchainImageFormat;
+VkImageLayout swapchainImageLayout;
 VkExtent2D swapchainExtent;
+VkFormat depthFormat;
 
 VkViewport viewport;
 VkRect2D scissor;
 
 VkPipelineLayout pipelineLayout;
 VkRenderPass renderPass;
+VkRenderPass depthPrepassRenderPass;
 VkPipeline graphicsPipeline;
+VkPipelineCache pipelineCache;
 
 VkCommandPool commandPool;
-VkCommandBuffer commandBuffer;
+std::vector<VkCommandBuffer> commandBuffers;
 
 }
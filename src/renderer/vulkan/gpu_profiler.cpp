@@ -0,0 +1,238 @@
+#include "renderer/vulkan/gpu_profiler.hpp"
+
+#include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/queue.hpp"
+#include "renderer/vulkan/timeline.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+namespace sunset
+{
+namespace
+{
+constexpr uint32 maxGpuZones = 64u;
+constexpr uint32 invalidZone = ~0u;
+
+struct GpuProfilerSlot
+{
+    std::array<const char*, maxGpuZones> names;
+    uint32                               zoneCount   = 0u;
+    uint64                               frameNumber = 0u;
+};
+
+VkQueryPool                  queryPool = VK_NULL_HANDLE;
+float64                      timestampPeriod;
+uint64                       timestampMask;
+int64                        gpuToCpuOffset;
+std::vector<GpuProfilerSlot> slots;
+uint32                       currentSlot  = 0u;
+uint64                       lastFrameEnd = 0u;
+
+std::array<uint64, maxGpuZones * 2> queryResults;
+
+auto toCpuTime(uint64 ticks) -> uint64
+{
+    return (int64)((ticks & timestampMask) * timestampPeriod) + gpuToCpuOffset;
+}
+
+auto slotFirstQuery(uint32 slot) -> uint32 { return slot * maxGpuZones * 2; }
+
+// Timestamps count device ticks from an unspecified origin. Write one and
+// compare it with the CPU clock around the submission to line the GPU track
+// up with the CPU zones in the trace.
+auto calibrate() -> void
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+    vkCmdWriteTimestamp(
+    commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 0);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &commandBuffer;
+
+    auto& profiler  = Profiler::get();
+    auto  cpuBefore = profiler.now();
+    waitForValue(
+    Timeline::Graphics, submitToTimeline(Timeline::Graphics, submitInfo));
+    auto cpuAfter = profiler.now();
+
+    uint64 ticks = 0u;
+    vkGetQueryPoolResults(
+    device, queryPool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks),
+    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+    gpuToCpuOffset = (int64)((cpuBefore + cpuAfter) / 2) -
+                     (int64)((ticks & timestampMask) * timestampPeriod);
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+}
+}
+
+auto createGpuProfiler(uint32 framesInFlight) -> void
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(
+    physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(
+    physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    auto indices   = findQueueFamilies(physicalDevice);
+    auto validBits = queueFamilies[indices.graphicsFamily.value()]
+                     .timestampValidBits;
+
+    // Without timestamp support the GPU track simply stays empty.
+    if (validBits == 0 || properties.limits.timestampPeriod == 0.0f) {
+        return;
+    }
+
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask   = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = slotFirstQuery(framesInFlight);
+
+    if (
+    vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan query pool.");
+    }
+
+    slots.assign(framesInFlight, {});
+    calibrate();
+}
+
+auto destroyGpuProfiler() -> void
+{
+    if (queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device, queryPool, nullptr);
+        queryPool = VK_NULL_HANDLE;
+    }
+    slots.clear();
+}
+
+auto beginGpuProfilerFrame(uint32 frameIndex, uint64 frameNumber) -> void
+{
+    if (queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    auto& slot   = slots[frameIndex];
+    lastFrameEnd = 0u;
+
+    if (
+    slot.zoneCount > 0 &&
+    vkGetQueryPoolResults(
+    device, queryPool, slotFirstQuery(frameIndex), slot.zoneCount * 2,
+    slot.zoneCount * 2 * sizeof(uint64), queryResults.data(), sizeof(uint64),
+    VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        auto& profiler = Profiler::get();
+        for (uint32 i = 0; i < slot.zoneCount; i++) {
+            auto end = toCpuTime(queryResults[i * 2 + 1]);
+            profiler.recordGpu(
+            slot.names[i], toCpuTime(queryResults[i * 2]), end,
+            slot.frameNumber);
+            lastFrameEnd = std::max(lastFrameEnd, end);
+        }
+    }
+
+    slot.zoneCount   = 0u;
+    slot.frameNumber = frameNumber;
+    currentSlot      = frameIndex;
+}
+
+auto getGpuFrameEnd() -> uint64 { return lastFrameEnd; }
+
+auto resetGpuZones(VkCommandBuffer commandBuffer) -> void
+{
+    if (queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    slots[currentSlot].zoneCount = 0u;
+    vkCmdResetQueryPool(
+    commandBuffer, queryPool, slotFirstQuery(currentSlot), maxGpuZones * 2);
+}
+
+auto beginGpuZone(VkCommandBuffer commandBuffer, const char* name) -> uint32
+{
+    if (queryPool == VK_NULL_HANDLE) {
+        return invalidZone;
+    }
+
+    auto& slot = slots[currentSlot];
+    if (slot.zoneCount == maxGpuZones) {
+        return invalidZone;
+    }
+
+    auto zone        = slot.zoneCount++;
+    slot.names[zone] = name;
+    vkCmdWriteTimestamp(
+    commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool,
+    slotFirstQuery(currentSlot) + zone * 2);
+
+    return zone;
+}
+
+auto endGpuZone(VkCommandBuffer commandBuffer, uint32 zone) -> void
+{
+    if (zone == invalidZone) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(
+    commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+    slotFirstQuery(currentSlot) + zone * 2 + 1);
+}
+
+auto getGpuZones() -> std::span<const char* const>
+{
+    if (queryPool == VK_NULL_HANDLE) {
+        return {};
+    }
+
+    const auto& slot = slots[currentSlot];
+    return {slot.names.data(), slot.zoneCount};
+}
+
+auto setGpuZones(const std::vector<const char*>& names) -> void
+{
+    if (queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    auto& slot     = slots[currentSlot];
+    slot.zoneCount = (uint32)std::min<size_t>(names.size(), maxGpuZones);
+    std::copy_n(names.begin(), slot.zoneCount, slot.names.begin());
+}
+
+GpuProfileZone::GpuProfileZone(VkCommandBuffer commandBuffer, const char* name)
+    : commandBuffer(commandBuffer), zone(beginGpuZone(commandBuffer, name))
+{}
+
+GpuProfileZone::~GpuProfileZone() { endGpuZone(commandBuffer, zone); }
+}
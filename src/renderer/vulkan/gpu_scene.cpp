@@ -0,0 +1,521 @@
+#include "renderer/vulkan/gpu_scene.hpp"
+
+#include "renderer/culling.hpp"
+#include "renderer/vulkan/buffer.hpp"
+#include "renderer/vulkan/deletion_queue.hpp"
+#include "renderer/vulkan/device.hpp"
+#include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/instancing.hpp"
+#include "renderer/vulkan/mesh.hpp"
+#include "renderer/vulkan/pipeline_registry.hpp"
+#include "renderer/vulkan/shader.hpp"
+#include "renderer/vulkan/timeline.hpp"
+#include "renderer/vulkan/upload.hpp"
+#include "utils/profiler.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+
+namespace sunset
+{
+namespace
+{
+constexpr uint32 cullGroupSize = 64u;
+// Draws the culling outputs have room for at first, doubled as needed.
+constexpr uint32 minCapacity = 1024u;
+
+// Matches DrawObject in cull.comp.
+struct GpuObject
+{
+    float32 boundingSphere[4];
+    float32 extents[4];
+    uint32  firstIndex;
+    uint32  indexCount;
+    uint32  instanceCount;
+    uint32  batch;
+    uint32  batchFirst;
+    uint32  firstInstance;
+    uint32  padding[2];
+};
+
+static_assert(sizeof(GpuObject) == 64u, "std430 layout of DrawObject");
+
+// Matches Constants in cull.comp. Planes are a normal and a distance, points
+// p with dot(normal, p) + distance >= 0 are inside.
+struct CullConstants
+{
+    float32 planes[6][4];
+    uint32  objectCount;
+    uint32  compact;
+};
+
+static_assert(sizeof(CullConstants) <= 128u, "guaranteed push constant size");
+
+// Consecutive objects sharing a pipeline and mesh, drawn with one indirect
+// draw from the commands at the same indices.
+struct DrawBatch
+{
+    PipelineHandle pipeline;
+    MeshHandle     mesh;
+    uint32         first;
+    uint32         count;
+};
+
+// A pool per set, so that sets are freed by destroying their pool whenever
+// the deletion queue gets to it.
+struct DescriptorSet
+{
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet  set  = VK_NULL_HANDLE;
+};
+
+// Draws uploaded by one setGpuSceneDraws call.
+struct SceneDraws
+{
+    Buffer                 objects;
+    DescriptorSet          descriptors;
+    uint64                 uploadValue = 0u;
+    uint32                 objectCount = 0u;
+    std::vector<DrawBatch> batches;
+};
+
+VkDescriptorSetLayout objectSetLayout;
+VkDescriptorSetLayout outputSetLayout;
+VkPipelineLayout      cullLayout;
+VkPipeline            cullPipeline;
+uint32                maxDrawCount;
+uint32                capacity;
+Frustum               cullFrustum = getClipSpaceFrustum();
+
+// Replaced by the newest draws once they are uploaded. The instances are
+// replaced right away, so nothing is drawn in between.
+std::optional<SceneDraws> activeDraws;
+std::optional<SceneDraws> pendingDraws;
+// Replaced before their upload finished. The graphics queue acquires them
+// all the same, so they live until it has.
+std::vector<SceneDraws> supersededDraws;
+
+DescriptorSet outputDescriptors;
+VkBuffer      drawCommands = VK_NULL_HANDLE;
+VkBuffer      drawCounts   = VK_NULL_HANDLE;
+
+auto createStorageSetLayout(uint32 bindingCount) -> VkDescriptorSetLayout
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings(bindingCount);
+    for (uint32 i = 0; i < bindingCount; i++) {
+        bindings[i].binding         = i;
+        bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = bindingCount;
+    layoutInfo.pBindings    = bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (
+    vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor set layout.");
+    }
+
+    return layout;
+}
+
+auto createStorageSet(
+VkDescriptorSetLayout layout, std::span<const VkBuffer> buffers)
+-> DescriptorSet
+{
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = (uint32)buffers.size();
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets       = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes    = &poolSize;
+
+    DescriptorSet descriptors;
+    if (
+    vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptors.pool) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool.");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = descriptors.pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &layout;
+
+    if (
+    vkAllocateDescriptorSets(device, &allocInfo, &descriptors.set) !=
+    VK_SUCCESS) {
+        vkDestroyDescriptorPool(device, descriptors.pool, nullptr);
+        throw std::runtime_error("Failed to allocate descriptor set.");
+    }
+
+    std::vector<VkDescriptorBufferInfo> bufferInfos(buffers.size());
+    std::vector<VkWriteDescriptorSet>   writes(buffers.size());
+    for (uint32 i = 0; i < buffers.size(); i++) {
+        bufferInfos[i].buffer = buffers[i];
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range  = VK_WHOLE_SIZE;
+
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet          = descriptors.set;
+        writes[i].dstBinding      = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo     = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(
+    device, (uint32)writes.size(), writes.data(), 0, nullptr);
+
+    return descriptors;
+}
+
+auto destroySceneDraws(SceneDraws& draws) -> void
+{
+    vkDestroyDescriptorPool(device, draws.descriptors.pool, nullptr);
+    destroyBuffer(draws.objects);
+}
+
+// Nothing recorded from now on uses the draws, but the command buffer being
+// recorded may still acquire them.
+auto retireSceneDraws(SceneDraws draws) -> void
+{
+    deferDestroy(
+    Timeline::Graphics, getSubmittedValue(Timeline::Graphics) + 1,
+    [draws = std::move(draws)]() mutable { destroySceneDraws(draws); });
+}
+
+// Called while recording, after acquireUploads.
+auto updateSceneDraws() -> void
+{
+    if (pendingDraws && isUploadComplete(pendingDraws->uploadValue)) {
+        if (activeDraws) {
+            retireSceneDraws(std::move(*activeDraws));
+        }
+        activeDraws = std::move(pendingDraws);
+        pendingDraws.reset();
+    }
+
+    std::erase_if(supersededDraws, [](SceneDraws& draws) {
+        if (!isUploadComplete(draws.uploadValue)) {
+            return false;
+        }
+        retireSceneDraws(std::move(draws));
+        return true;
+    });
+}
+
+auto recordCull(const PassContext& pass) -> bool
+{
+    updateSceneDraws();
+    if (!activeDraws) {
+        return false;
+    }
+
+    if (activeDraws->objectCount != 0u) {
+        VkDescriptorSet sets[] = {
+        activeDraws->descriptors.set, outputDescriptors.set};
+        CullConstants constants{};
+        for (uint32 i = 0; i < 6u; i++) {
+            const auto& plane = cullFrustum.planes[i];
+            std::copy_n(plane.normal, 3, constants.planes[i]);
+            constants.planes[i][3] = plane.distance;
+        }
+        constants.objectCount = activeDraws->objectCount;
+        constants.compact     = isDrawIndirectCountEnabled() ? 1u : 0u;
+
+        vkCmdBindPipeline(
+        pass.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdBindDescriptorSets(
+        pass.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 2,
+        sets, 0, nullptr);
+        vkCmdPushConstants(
+        pass.commandBuffer, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+        sizeof(constants), &constants);
+        vkCmdDispatch(
+        pass.commandBuffer,
+        (activeDraws->objectCount + cullGroupSize - 1) / cullGroupSize, 1, 1);
+    }
+
+    // Draw again once the newest draws are in.
+    return !pendingDraws.has_value();
+}
+}
+
+auto createGpuScene() -> void
+{
+    if (!isMultiDrawIndirectEnabled()) {
+        throw std::runtime_error(
+        "GPU-driven rendering needs multiDrawIndirect.");
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    maxDrawCount = properties.limits.maxDrawIndirectCount;
+    capacity     = minCapacity;
+
+    objectSetLayout = createStorageSetLayout(1);
+    outputSetLayout = createStorageSetLayout(2);
+
+    VkDescriptorSetLayout setLayouts[] = {objectSetLayout, outputSetLayout};
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset     = 0;
+    pushConstantRange.size       = sizeof(CullConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 2;
+    layoutInfo.pSetLayouts    = setLayouts;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges    = &pushConstantRange;
+
+    if (
+    vkCreatePipelineLayout(device, &layoutInfo, nullptr, &cullLayout) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull pipeline layout.");
+    }
+
+    auto shaderModule = createShaderModule("cull.comp");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType =
+    VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName  = "main";
+    pipelineInfo.layout       = cullLayout;
+
+    auto result = vkCreateComputePipelines(
+    device, pipelineCache, 1, &pipelineInfo, nullptr, &cullPipeline);
+    destroyShaderModule(shaderModule);
+
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull pipeline.");
+    }
+}
+
+auto destroyGpuScene() -> void
+{
+    for (auto& draws : supersededDraws) {
+        destroySceneDraws(draws);
+    }
+    supersededDraws.clear();
+    if (pendingDraws) {
+        destroySceneDraws(*pendingDraws);
+        pendingDraws.reset();
+    }
+    if (activeDraws) {
+        destroySceneDraws(*activeDraws);
+        activeDraws.reset();
+    }
+
+    if (outputDescriptors.pool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, outputDescriptors.pool, nullptr);
+    }
+    outputDescriptors = {};
+    drawCommands      = VK_NULL_HANDLE;
+    drawCounts        = VK_NULL_HANDLE;
+
+    vkDestroyPipeline(device, cullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, cullLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, outputSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, objectSetLayout, nullptr);
+}
+
+auto setGpuSceneDraws(const std::vector<InstancedDraw>& instancedDraws) -> bool
+{
+    PROFILE_ZONE("Upload GPU scene");
+
+    std::vector<uint32> order(instancedDraws.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32 a, uint32 b) {
+        return std::tuple(instancedDraws[a].pipeline, instancedDraws[a].mesh) <
+               std::tuple(instancedDraws[b].pipeline, instancedDraws[b].mesh);
+    });
+
+    SceneDraws             draws;
+    std::vector<GpuObject> objects;
+    objects.reserve(instancedDraws.size());
+    for (auto i : order) {
+        const auto& draw = instancedDraws[i];
+
+        if (
+        draws.batches.empty() ||
+        draws.batches.back().pipeline != draw.pipeline ||
+        draws.batches.back().mesh != draw.mesh ||
+        draws.batches.back().count == maxDrawCount) {
+            draws.batches.push_back(
+            {draw.pipeline, draw.mesh, (uint32)objects.size(), 0u});
+        }
+
+        auto&     batch = draws.batches.back();
+        GpuObject object{};
+        std::copy_n(draw.bounds.center, 3, object.boundingSphere);
+        object.boundingSphere[3] = draw.bounds.radius;
+        std::copy_n(draw.extents, 3, object.extents);
+        object.firstIndex        = draw.firstIndex;
+        object.indexCount        = draw.indexCount;
+        object.instanceCount     = draw.instanceCount;
+        object.batch             = (uint32)draws.batches.size() - 1;
+        object.batchFirst        = batch.first;
+        object.firstInstance     = draw.firstInstance;
+        objects.push_back(object);
+        batch.count++;
+    }
+
+    // Storage buffers may not be empty.
+    auto size = std::max<size_t>(objects.size(), 1u) * sizeof(GpuObject);
+    draws.objectCount = (uint32)objects.size();
+    draws.objects     = createBuffer(
+    size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    MemoryUsage::GpuOnly);
+    if (!objects.empty()) {
+        draws.uploadValue = uploadBuffer(
+        draws.objects, 0, objects.data(), objects.size() * sizeof(GpuObject),
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+    draws.descriptors =
+    createStorageSet(objectSetLayout, {&draws.objects.buffer, 1u});
+
+    if (pendingDraws) {
+        supersededDraws.push_back(std::move(*pendingDraws));
+    }
+    pendingDraws = std::move(draws);
+
+    auto grown = false;
+    while (capacity < objects.size()) {
+        capacity *= 2u;
+        grown = true;
+    }
+
+    return grown;
+}
+
+auto setGpuCullFrustum(const Frustum& frustum) -> void
+{
+    cullFrustum = frustum;
+}
+
+auto addGpuCullPasses(RenderGraph& graph) -> GpuCullOutputs
+{
+    GpuCullOutputs outputs;
+    outputs.commands = graph.createBuffer(
+    "Draw commands",
+    RenderBufferDesc{capacity * sizeof(VkDrawIndexedIndirectCommand)});
+    outputs.counts = graph.createBuffer(
+    "Draw counts", RenderBufferDesc{capacity * sizeof(uint32)});
+
+    graph.addPass("Reset draw counts", PassType::Transfer)
+    .write(outputs.counts, ResourceUsage::TransferWrite)
+    .setExecute([](const PassContext& pass) {
+        vkCmdFillBuffer(pass.commandBuffer, drawCounts, 0, VK_WHOLE_SIZE, 0u);
+        return true;
+    });
+
+    graph.addPass("Cull draws", PassType::Compute)
+    .write(outputs.commands, ResourceUsage::StorageWrite)
+    .write(outputs.counts, ResourceUsage::StorageWrite)
+    .setExecute(recordCull);
+
+    return outputs;
+}
+
+auto bindGpuCullOutputs(const RenderGraph& graph, GpuCullOutputs outputs)
+-> void
+{
+    // Frames recorded with the previous graph may still be in flight.
+    if (outputDescriptors.pool != VK_NULL_HANDLE) {
+        deferDestroy([pool = outputDescriptors.pool] {
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        });
+    }
+
+    drawCommands = graph.getBuffer(outputs.commands);
+    drawCounts   = graph.getBuffer(outputs.counts);
+
+    VkBuffer buffers[] = {drawCommands, drawCounts};
+    outputDescriptors  = createStorageSet(outputSetLayout, buffers);
+}
+
+auto recordGpuSceneDraws(const PassContext& pass, PipelineVariant variant)
+-> bool
+{
+    // The instances already belong to the pending draws.
+    if (!activeDraws || pendingDraws || !bindInstances(pass.commandBuffer)) {
+        return false;
+    }
+
+    auto frameViewport   = viewport;
+    frameViewport.width  = pass.extent.width;
+    frameViewport.height = pass.extent.height;
+    vkCmdSetViewport(pass.commandBuffer, 0, 1, &frameViewport);
+
+    auto frameScissor   = scissor;
+    frameScissor.extent = pass.extent;
+    vkCmdSetScissor(pass.commandBuffer, 0, 1, &frameScissor);
+
+    constexpr auto stride = (uint32)sizeof(VkDrawIndexedIndirectCommand);
+
+    auto       complete      = true;
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    MeshHandle boundMesh     = ~0u;
+    for (uint32 i = 0; i < activeDraws->batches.size(); i++) {
+        const auto& batch = activeDraws->batches[i];
+
+        auto        handle   = getPipelineVariant(batch.pipeline, variant);
+        auto        pipeline = getPipeline(handle);
+        const auto& mesh     = getMesh(batch.mesh);
+        if (pipeline == VK_NULL_HANDLE || !isUploadComplete(mesh.uploadValue)) {
+            complete = false;
+            continue;
+        }
+
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(
+            pass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+
+        if (batch.mesh != boundMesh) {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(
+            pass.commandBuffer, 0, 1, &mesh.vertexBuffer.buffer, &offset);
+            vkCmdBindIndexBuffer(
+            pass.commandBuffer, mesh.indexBuffer.buffer, 0, mesh.indexType);
+            boundMesh = batch.mesh;
+        }
+
+        VkDeviceSize commandOffset = batch.first * stride;
+        if (isDrawIndirectCountEnabled()) {
+            vkCmdDrawIndexedIndirectCount(
+            pass.commandBuffer, drawCommands, commandOffset, drawCounts,
+            i * sizeof(uint32), batch.count, stride);
+        }
+        else {
+            vkCmdDrawIndexedIndirect(
+            pass.commandBuffer, drawCommands, commandOffset, batch.count,
+            stride);
+        }
+    }
+
+    return complete;
+}
+}
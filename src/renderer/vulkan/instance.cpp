@@ -2,6 +2,7 @@
 
 #include "renderer/vulkan/function.hpp"
 #include "renderer/vulkan/global.hpp"
+#include "utils/memory.hpp"
 #include "utils/string.hpp"
 #include "utils/type.hpp"
 
@@ -9,7 +10,6 @@
 #include <vulkan/vulkan.h>
 
 #include <iostream>
-#include <set>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -17,6 +17,24 @@
 
 namespace sunset
 {
+namespace
+{
+uint32 instanceApiVersion = VK_API_VERSION_1_0;
+
+// Vulkan 1.0 loaders do not export vkEnumerateInstanceVersion.
+auto queryLoaderApiVersion() -> uint32
+{
+    auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)
+    vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+
+    uint32 version = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr) {
+        enumerateInstanceVersion(&version);
+    }
+
+    return version;
+}
+}
 
 auto checkInstanceExtensionSupport(
 const std::vector<std::string>& extensionNames) -> void
@@ -24,18 +42,14 @@ const std::vector<std::string>& extensionNames) -> void
     uint32 extensionCount;
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
 
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    std::pmr::vector<VkExtensionProperties> availableExtensions(
+    extensionCount, &getFrameArena());
     vkEnumerateInstanceExtensionProperties(
     nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensionNames(
-    extensionNames.begin(), extensionNames.end());
-
-    for (const auto& extension : availableExtensions) {
-        requiredExtensionNames.erase(extension.extensionName);
-    }
-
-    if (!requiredExtensionNames.empty()) {
+    if (!containsAllNames(
+        extensionNames, availableExtensions,
+        [](const auto& extension) { return extension.extensionName; })) {
         throw std::runtime_error(
         "Vulkan required instance extensions not available.");
     }
@@ -47,17 +61,13 @@ auto checkInstanceLayerSupport(const std::vector<std::string>& layerNames)
     uint32 layerCount;
     vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
 
-    std::vector<VkLayerProperties> availableLayers(layerCount);
+    std::pmr::vector<VkLayerProperties> availableLayers(
+    layerCount, &getFrameArena());
     vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
 
-    std::set<std::string> requiredLayerNames(
-    layerNames.begin(), layerNames.end());
-
-    for (const auto& availableLayer : availableLayers) {
-        requiredLayerNames.erase(availableLayer.layerName);
-    }
-
-    if (!requiredLayerNames.empty()) {
+    if (!containsAllNames(layerNames, availableLayers, [](const auto& layer) {
+            return layer.layerName;
+        })) {
         throw std::runtime_error(
         "Vulkan required instance layers not available.");
     }
@@ -111,8 +121,14 @@ const std::vector<std::string>& layerNames) -> void
 {
     checkInstanceExtensionSupport(extensionNames);
     checkInstanceLayerSupport(layerNames);
-    auto extensionNamesC = toCStringArray(extensionNames);
-    auto layerNamesC     = toCStringArray(layerNames);
+    auto extensionNamesC = toCStringArray(extensionNames, &getFrameArena());
+    auto layerNamesC     = toCStringArray(layerNames, &getFrameArena());
+
+    // 1.2 brings timeline semaphores into core. Devices may still report an
+    // older version, see isTimelineSemaphoreEnabled.
+    instanceApiVersion = queryLoaderApiVersion() >= VK_API_VERSION_1_2
+                         ? VK_API_VERSION_1_2
+                         : VK_API_VERSION_1_0;
 
     VkApplicationInfo appInfo{};
     appInfo.sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -120,7 +136,7 @@ const std::vector<std::string>& layerNames) -> void
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName        = "Sunset Engine";
     appInfo.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion         = VK_API_VERSION_1_0;
+    appInfo.apiVersion         = instanceApiVersion;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -148,6 +164,8 @@ const std::vector<std::string>& layerNames) -> void
 #endif
 }
 
+auto getInstanceApiVersion() -> uint32 { return instanceApiVersion; }
+
 auto destroyInstance() -> void
 {
 #ifdef DEBUG
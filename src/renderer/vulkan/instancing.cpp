@@ -0,0 +1,219 @@
+#include "renderer/vulkan/instancing.hpp"
+
+#include "renderer/vulkan/buffer.hpp"
+#include "renderer/vulkan/deletion_queue.hpp"
+#include "renderer/vulkan/pipeline_registry.hpp"
+#include "renderer/vulkan/timeline.hpp"
+#include "renderer/vulkan/upload.hpp"
+#include "utils/profiler.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <tuple>
+
+namespace sunset
+{
+namespace
+{
+struct InstanceBuffer
+{
+    Buffer buffer;
+    uint64 uploadValue = 0u;
+};
+
+InstanceBuffer instanceBuffer;
+// Replaced while still uploading. The graphics queue acquires them all the
+// same, so they are kept until it has, see collectInstanceBuffers.
+std::vector<InstanceBuffer> replacedBuffers;
+
+using DrawKey = std::tuple<MeshHandle, PipelineHandle, uint32, uint32>;
+
+auto transformSphere(const BoundingSphere& sphere, const Instance& instance)
+-> BoundingSphere
+{
+    BoundingSphere result;
+    for (uint32 axis = 0; axis < 3u; axis++) {
+        result.center[axis] =
+        sphere.center[axis] * instance.scale + instance.offset[axis];
+    }
+    result.radius = sphere.radius * std::abs(instance.scale);
+
+    return result;
+}
+
+// Centered on the bounding box of the instance spheres, like mesh bounds.
+auto setInstanceBounds(
+InstancedDraw& draw, const BoundingSphere& meshBounds,
+std::span<const Instance> instances) -> void
+{
+    float32 min[3], max[3];
+    std::fill_n(min, 3, std::numeric_limits<float32>::max());
+    std::fill_n(max, 3, std::numeric_limits<float32>::lowest());
+    for (const auto& instance : instances) {
+        auto sphere = transformSphere(meshBounds, instance);
+        for (uint32 axis = 0; axis < 3u; axis++) {
+            auto center = sphere.center[axis];
+            min[axis]   = std::min(min[axis], center - sphere.radius);
+            max[axis]   = std::max(max[axis], center + sphere.radius);
+        }
+    }
+
+    auto& bounds = draw.bounds;
+    for (uint32 axis = 0; axis < 3u; axis++) {
+        bounds.center[axis] = 0.5f * (min[axis] + max[axis]);
+        draw.extents[axis]  = 0.5f * (max[axis] - min[axis]);
+    }
+
+    for (const auto& instance : instances) {
+        auto    sphere          = transformSphere(meshBounds, instance);
+        float32 distanceSquared = 0.0f;
+        for (uint32 axis = 0; axis < 3u; axis++) {
+            auto delta = sphere.center[axis] - bounds.center[axis];
+            distanceSquared += delta * delta;
+        }
+        bounds.radius =
+        std::max(bounds.radius, std::sqrt(distanceSquared) + sphere.radius);
+    }
+}
+
+auto replaceInstanceBuffer(InstanceBuffer buffer) -> void
+{
+    if (instanceBuffer.buffer.buffer != VK_NULL_HANDLE) {
+        replacedBuffers.push_back(instanceBuffer);
+    }
+    instanceBuffer = buffer;
+    collectInstanceBuffers();
+}
+}
+
+auto buildInstancedDraws(const std::vector<DrawItem>& drawItems)
+-> std::vector<InstancedDraw>
+{
+    PROFILE_ZONE("Build instanced draws");
+
+    auto                 defaultPipeline = getDefaultPipeline();
+    std::vector<DrawKey> keys;
+    keys.reserve(drawItems.size());
+    for (const auto& item : drawItems) {
+        auto indexCount = item.indexCount;
+        if (indexCount == 0u) {
+            indexCount = getMesh(item.mesh).indexCount - item.firstIndex;
+        }
+        auto pipeline = item.pipeline != invalidPipelineHandle
+                        ? item.pipeline
+                        : defaultPipeline;
+        keys.emplace_back(item.mesh, pipeline, item.firstIndex, indexCount);
+    }
+
+    // Equal keys end up adjacent, each run in the order of its items.
+    std::vector<uint32> order(drawItems.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32 a, uint32 b) {
+        return keys[a] < keys[b];
+    });
+
+    // Start of each run in order, sorted by the first item of the run.
+    std::vector<uint32> runs;
+    for (uint32 i = 0; i < order.size(); i++) {
+        if (i == 0u || keys[order[i]] != keys[order[i - 1]]) {
+            runs.push_back(i);
+        }
+    }
+    std::sort(runs.begin(), runs.end(), [&](uint32 a, uint32 b) {
+        return order[a] < order[b];
+    });
+
+    std::vector<InstancedDraw> draws;
+    std::vector<Instance>      instances;
+    draws.reserve(runs.size());
+    instances.reserve(drawItems.size());
+    for (auto run : runs) {
+        const auto& key = keys[order[run]];
+
+        InstancedDraw draw{};
+        draw.mesh          = std::get<0>(key);
+        draw.pipeline      = std::get<1>(key);
+        draw.firstIndex    = std::get<2>(key);
+        draw.indexCount    = std::get<3>(key);
+        draw.firstInstance = (uint32)instances.size();
+        for (auto i = run; i < order.size() && keys[order[i]] == key; i++) {
+            const auto& item = drawItems[order[i]];
+            instances.insert(
+            instances.end(), item.instanceCount, item.instance);
+        }
+        draw.instanceCount = (uint32)instances.size() - draw.firstInstance;
+        if (draw.instanceCount == 0u) {
+            continue;
+        }
+
+        setInstanceBounds(
+        draw, getMesh(draw.mesh).bounds,
+        {instances.data() + draw.firstInstance, draw.instanceCount});
+        draws.push_back(draw);
+    }
+
+    // Vertex buffers may not be empty.
+    auto size = std::max<size_t>(instances.size(), 1u) * sizeof(Instance);
+
+    InstanceBuffer buffer;
+    buffer.buffer = createBuffer(
+    size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    MemoryUsage::GpuOnly);
+    if (!instances.empty()) {
+        buffer.uploadValue = uploadBuffer(
+        buffer.buffer, 0, instances.data(),
+        instances.size() * sizeof(Instance),
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    }
+    replaceInstanceBuffer(buffer);
+
+    return draws;
+}
+
+auto collectInstanceBuffers() -> void
+{
+    // Draws recorded from now on use the new buffer, the frame being
+    // recorded may still acquire the old ones.
+    std::erase_if(replacedBuffers, [](InstanceBuffer& replaced) {
+        if (!isUploadComplete(replaced.uploadValue)) {
+            return false;
+        }
+        deferDestroy(
+        Timeline::Graphics, getSubmittedValue(Timeline::Graphics) + 1,
+        [buffer = replaced.buffer]() mutable { destroyBuffer(buffer); });
+        return true;
+    });
+}
+
+auto destroyInstances() -> void
+{
+    for (auto& replaced : replacedBuffers) {
+        destroyBuffer(replaced.buffer);
+    }
+    replacedBuffers.clear();
+
+    if (instanceBuffer.buffer.buffer != VK_NULL_HANDLE) {
+        destroyBuffer(instanceBuffer.buffer);
+    }
+    instanceBuffer = {};
+}
+
+auto bindInstances(VkCommandBuffer commandBuffer) -> bool
+{
+    if (!isUploadComplete(instanceBuffer.uploadValue)) {
+        return false;
+    }
+
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(
+    commandBuffer, 1, 1, &instanceBuffer.buffer.buffer, &offset);
+
+    return true;
+}
+}
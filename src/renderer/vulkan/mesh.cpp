@@ -0,0 +1,200 @@
+#include "renderer/vulkan/mesh.hpp"
+
+#include "renderer/vulkan/deletion_queue.hpp"
+#include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/upload.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+namespace sunset
+{
+namespace
+{
+std::vector<Mesh>       meshes;
+std::vector<MeshHandle> freeHandles;
+
+// Centered on the bounding box, not minimal but cheap and close enough.
+auto computeBounds(const std::vector<Vertex>& vertices) -> BoundingSphere
+{
+    float32 min[3], max[3];
+    for (uint32 axis = 0; axis < 3u; axis++) {
+        min[axis] = max[axis] = vertices.front().position[axis];
+    }
+    for (const auto& vertex : vertices) {
+        for (uint32 axis = 0; axis < 3u; axis++) {
+            min[axis] = std::min(min[axis], vertex.position[axis]);
+            max[axis] = std::max(max[axis], vertex.position[axis]);
+        }
+    }
+
+    BoundingSphere bounds;
+    for (uint32 axis = 0; axis < 3u; axis++) {
+        bounds.center[axis] = 0.5f * (min[axis] + max[axis]);
+    }
+
+    float32 radiusSquared = 0.0f;
+    for (const auto& vertex : vertices) {
+        float32 distanceSquared = 0.0f;
+        for (uint32 axis = 0; axis < 3u; axis++) {
+            auto delta = vertex.position[axis] - bounds.center[axis];
+            distanceSquared += delta * delta;
+        }
+        radiusSquared = std::max(radiusSquared, distanceSquared);
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+
+    return bounds;
+}
+}
+
+auto getVertexLayout() -> VertexLayout
+{
+    VertexLayout layout;
+
+    VkVertexInputBindingDescription binding{};
+    binding.binding   = 0;
+    binding.stride    = sizeof(Vertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    layout.bindings.push_back(binding);
+
+    VkVertexInputBindingDescription instanceBinding{};
+    instanceBinding.binding   = 1;
+    instanceBinding.stride    = sizeof(Instance);
+    instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    layout.bindings.push_back(instanceBinding);
+
+    VkVertexInputAttributeDescription position{};
+    position.location = 0;
+    position.binding  = 0;
+    position.format   = VK_FORMAT_R32G32B32_SFLOAT;
+    position.offset   = offsetof(Vertex, position);
+    layout.attributes.push_back(position);
+
+    VkVertexInputAttributeDescription color{};
+    color.location = 1;
+    color.binding  = 0;
+    color.format   = VK_FORMAT_R32G32B32_SFLOAT;
+    color.offset   = offsetof(Vertex, color);
+    layout.attributes.push_back(color);
+
+    // Offset and scale in a single attribute.
+    VkVertexInputAttributeDescription instance{};
+    instance.location = 2;
+    instance.binding  = 1;
+    instance.format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+    instance.offset   = offsetof(Instance, offset);
+    layout.attributes.push_back(instance);
+
+    return layout;
+}
+
+auto createMeshes() -> void
+{
+    std::vector<Vertex> vertices = {
+    {{0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+    {{0.5f, 0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+    {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}}};
+
+    createMesh(vertices, {0u, 1u, 2u});
+}
+
+auto destroyMeshes() -> void
+{
+    for (auto& mesh : meshes) {
+        destroyBuffer(mesh.vertexBuffer);
+        destroyBuffer(mesh.indexBuffer);
+    }
+
+    meshes.clear();
+    freeHandles.clear();
+}
+
+auto createMesh(
+const std::vector<Vertex>& vertices, const std::vector<uint32>& indices)
+-> MeshHandle
+{
+    if (vertices.empty() || indices.empty()) {
+        throw std::runtime_error("Mesh has no vertices or indices.");
+    }
+
+    for (auto index : indices) {
+        if (index >= vertices.size()) {
+            throw std::runtime_error("Mesh index out of range.");
+        }
+    }
+
+    Mesh mesh;
+    mesh.vertexCount = (uint32)vertices.size();
+    mesh.indexCount  = (uint32)indices.size();
+    mesh.bounds      = computeBounds(vertices);
+
+    VkDeviceSize vertexSize = vertices.size() * sizeof(Vertex);
+    mesh.vertexBuffer       = createBuffer(
+    vertexSize,
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    MemoryUsage::GpuOnly);
+    uploadBuffer(
+    mesh.vertexBuffer, 0, vertices.data(), vertexSize,
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+    std::vector<uint16> shortIndices;
+    const void*         indexData = indices.data();
+    VkDeviceSize        indexSize = indices.size() * sizeof(uint32);
+
+    if (vertices.size() <= std::numeric_limits<uint16>::max() + 1u) {
+        shortIndices.assign(indices.begin(), indices.end());
+        indexData      = shortIndices.data();
+        indexSize      = shortIndices.size() * sizeof(uint16);
+        mesh.indexType = VK_INDEX_TYPE_UINT16;
+    }
+
+    mesh.indexBuffer = createBuffer(
+    indexSize,
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    MemoryUsage::GpuOnly);
+    mesh.uploadValue = uploadBuffer(
+    mesh.indexBuffer, 0, indexData, indexSize,
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+
+    if (!freeHandles.empty()) {
+        auto handle = freeHandles.back();
+        freeHandles.pop_back();
+        meshes[handle] = mesh;
+        return handle;
+    }
+
+    meshes.push_back(mesh);
+    return (MeshHandle)(meshes.size() - 1);
+}
+
+auto destroyMesh(MeshHandle handle) -> void
+{
+    auto& mesh = meshes.at(handle);
+    if (mesh.vertexBuffer.buffer == VK_NULL_HANDLE) {
+        throw std::runtime_error("Mesh destroyed twice.");
+    }
+
+    // The graphics queue has not acquired the buffers yet, it would still
+    // reference them after they are gone.
+    if (!isUploadComplete(mesh.uploadValue)) {
+        throw std::runtime_error("Mesh destroyed while still uploading.");
+    }
+
+    deferDestroy([vertexBuffer = mesh.vertexBuffer,
+                  indexBuffer  = mesh.indexBuffer]() mutable {
+        destroyBuffer(vertexBuffer);
+        destroyBuffer(indexBuffer);
+    });
+
+    mesh = {};
+    freeHandles.push_back(handle);
+}
+
+auto getMesh(MeshHandle handle) -> const Mesh& { return meshes.at(handle); }
+}
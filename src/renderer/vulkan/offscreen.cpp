@@ -0,0 +1,88 @@
+#include "renderer/vulkan/offscreen.hpp"
+
+#include "renderer/vulkan/allocator.hpp"
+#include "renderer/vulkan/global.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <stdexcept>
+#include <vector>
+
+namespace sunset
+{
+namespace
+{
+std::vector<Allocation> offscreenImageAllocations;
+}
+
+auto createOffscreenTargets(uint32 width, uint32 height, uint32 imageCount)
+-> void
+{
+    swapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    swapchainImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    swapchainExtent      = {width, height};
+
+    swapchainImages.resize(imageCount);
+    swapchainImageViews.resize(imageCount);
+    offscreenImageAllocations.resize(imageCount);
+
+    for (uint32 i = 0; i < imageCount; i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.format        = swapchainImageFormat;
+        imageInfo.extent        = {width, height, 1};
+        imageInfo.mipLevels     = 1;
+        imageInfo.arrayLayers   = 1;
+        imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                  VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (
+        vkCreateImage(device, &imageInfo, nullptr, &swapchainImages[i]) !=
+        VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan offscreen image.");
+        }
+
+        offscreenImageAllocations[i] = allocateImageMemory(
+        swapchainImages[i], imageInfo.tiling, MemoryUsage::GpuOnly);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType        = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image        = swapchainImages[i];
+        viewInfo.viewType     = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format       = swapchainImageFormat;
+        viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+        viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel   = 0;
+        viewInfo.subresourceRange.levelCount     = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount     = 1;
+
+        if (
+        vkCreateImageView(
+        device, &viewInfo, nullptr, &swapchainImageViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image views!");
+        }
+    }
+}
+
+auto destroyOffscreenTargets() -> void
+{
+    for (size_t i = 0; i < swapchainImages.size(); i++) {
+        vkDestroyImageView(device, swapchainImageViews[i], nullptr);
+        vkDestroyImage(device, swapchainImages[i], nullptr);
+        freeMemory(offscreenImageAllocations[i]);
+    }
+
+    swapchainImages.clear();
+    swapchainImageViews.clear();
+    offscreenImageAllocations.clear();
+}
+}
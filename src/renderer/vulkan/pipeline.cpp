@@ -1,37 +1,142 @@
 #include "renderer/vulkan/pipeline.hpp"
 
 #include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/mesh.hpp"
+#include "renderer/vulkan/pipeline_registry.hpp"
 #include "renderer/vulkan/render_pass.hpp"
 #include "renderer/vulkan/shader.hpp"
 
+#include "utils/hash.hpp"
 #include "utils/type.hpp"
 
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <array>
 #include <stdexcept>
 
 namespace sunset
 {
-auto createGraphicsPipeline() -> void
+namespace
 {
-    auto vertexShaderModule = createShaderModule("shader/spirv/basic.vert.spv");
-    auto fragmentShaderModule =
-    createShaderModule("shader/spirv/basic.frag.spv");
-    createRenderPass();
+PipelineHandle defaultPipeline = invalidPipelineHandle;
+}
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount         = 0;
-    pipelineLayoutInfo.pSetLayouts            = nullptr;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges    = nullptr;
+auto PipelineDesc::operator==(const PipelineDesc& other) const -> bool
+{
+    auto sameBindings = std::ranges::equal(
+    vertexLayout.bindings, other.vertexLayout.bindings,
+    [](const auto& a, const auto& b) {
+        return a.binding == b.binding && a.stride == b.stride &&
+               a.inputRate == b.inputRate;
+    });
+    auto sameAttributes = std::ranges::equal(
+    vertexLayout.attributes, other.vertexLayout.attributes,
+    [](const auto& a, const auto& b) {
+        return a.location == b.location && a.binding == b.binding &&
+               a.format == b.format && a.offset == b.offset;
+    });
 
-    if (
-    vkCreatePipelineLayout(
-    device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
+    return sameBindings && sameAttributes &&
+           vertexShader == other.vertexShader &&
+           fragmentShader == other.fragmentShader &&
+           shaderDefines == other.shaderDefines &&
+           topology == other.topology && polygonMode == other.polygonMode &&
+           cullMode == other.cullMode && frontFace == other.frontFace &&
+           blendEnable == other.blendEnable &&
+           colorWriteMask == other.colorWriteMask &&
+           depthTestEnable == other.depthTestEnable &&
+           depthWriteEnable == other.depthWriteEnable &&
+           depthCompareOp == other.depthCompareOp &&
+           renderPass == other.renderPass && layout == other.layout;
+}
+
+auto PipelineDesc::hash() const -> uint64
+{
+    auto seed = hashString(vertexShader);
+    seed      = hashString(fragmentShader, seed);
+
+    for (const auto& define : shaderDefines) {
+        seed = hashString(define, seed);
+    }
+
+    for (const auto& binding : vertexLayout.bindings) {
+        seed = hashValue(binding, seed);
+    }
+    for (const auto& attribute : vertexLayout.attributes) {
+        seed = hashValue(attribute, seed);
     }
 
+    seed = hashValue(topology, seed);
+    seed = hashValue(polygonMode, seed);
+    seed = hashValue(cullMode, seed);
+    seed = hashValue(frontFace, seed);
+    seed = hashValue(blendEnable, seed);
+    seed = hashValue(colorWriteMask, seed);
+    seed = hashValue(depthTestEnable, seed);
+    seed = hashValue(depthWriteEnable, seed);
+    seed = hashValue(depthCompareOp, seed);
+    seed = hashValue(renderPass, seed);
+    seed = hashValue(layout, seed);
+
+    return seed;
+}
+
+auto getDefaultPipelineDesc() -> PipelineDesc
+{
+    PipelineDesc desc;
+    desc.vertexShader   = "basic.vert";
+    desc.fragmentShader = "basic.frag";
+    desc.vertexLayout   = getVertexLayout();
+
+    desc.depthTestEnable  = true;
+    desc.depthWriteEnable = true;
+    desc.depthCompareOp   = VK_COMPARE_OP_LESS;
+
+    return desc;
+}
+
+auto getPipelineVariantDesc(const PipelineDesc& desc, PipelineVariant variant)
+-> PipelineDesc
+{
+    // Blended surfaces do not occlude, they are tested against the opaque
+    // depth as usual.
+    auto opaque = desc.depthTestEnable && desc.depthWriteEnable &&
+                  !desc.blendEnable;
+
+    auto variantDesc = desc;
+    switch (variant) {
+        case PipelineVariant::Default:
+            break;
+        case PipelineVariant::DepthPrepass:
+            variantDesc.fragmentShader.clear();
+            variantDesc.blendEnable      = false;
+            variantDesc.colorWriteMask   = 0u;
+            variantDesc.depthWriteEnable = opaque;
+            variantDesc.renderPass       = depthPrepassRenderPass;
+            break;
+        case PipelineVariant::DepthEqual:
+            // The prepass wrote all the depth, the main pass reads it only.
+            variantDesc.depthWriteEnable = false;
+            if (opaque) {
+                variantDesc.depthCompareOp = VK_COMPARE_OP_EQUAL;
+            }
+            break;
+    }
+
+    return variantDesc;
+}
+
+auto buildGraphicsPipeline(const PipelineDesc& desc) -> VkPipeline
+{
+    auto depthOnly = desc.fragmentShader.empty();
+
+    auto vertexShaderModule =
+    createShaderModule(desc.vertexShader, desc.shaderDefines);
+    auto fragmentShaderModule =
+    depthOnly ? VK_NULL_HANDLE
+              : createShaderModule(desc.fragmentShader, desc.shaderDefines);
+
     VkPipelineShaderStageCreateInfo vertexShaderStageInfo{};
     vertexShaderStageInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -49,7 +154,7 @@ auto createGraphicsPipeline() -> void
     VkPipelineShaderStageCreateInfo shaderStages[]{
     vertexShaderStageInfo, fragmentShaderStageInfo};
 
-    std::vector<VkDynamicState> dynamicStates = {
+    std::array<VkDynamicState, 2> dynamicStates = {
     VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 
     VkPipelineDynamicStateCreateInfo dynamicStateInfos{};
@@ -58,47 +163,43 @@ auto createGraphicsPipeline() -> void
     dynamicStateInfos.dynamicStateCount = (uint32)dynamicStates.size();
     dynamicStateInfos.pDynamicStates    = dynamicStates.data();
 
+    const auto& vertexLayout = desc.vertexLayout;
+
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount   = 0;
-    vertexInputInfo.pVertexBindingDescriptions      = nullptr;
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputInfo.pVertexAttributeDescriptions    = nullptr;
+    vertexInputInfo.vertexBindingDescriptionCount =
+    (uint32)vertexLayout.bindings.size();
+    vertexInputInfo.pVertexBindingDescriptions = vertexLayout.bindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount =
+    (uint32)vertexLayout.attributes.size();
+    vertexInputInfo.pVertexAttributeDescriptions =
+    vertexLayout.attributes.data();
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
     inputAssemblyInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssemblyInfo.topology               = desc.topology;
     inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
 
-    viewport.x        = 0.0f;
-    viewport.y        = 0.0f;
-    viewport.width    = (float)swapchainExtent.width;
-    viewport.height   = (float)swapchainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    scissor.offset = {0, 0};
-    scissor.extent = swapchainExtent;
-
+    // Viewport and scissor are dynamic, only their count is baked in.
     VkPipelineViewportStateCreateInfo viewportStateInfo{};
     viewportStateInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportStateInfo.viewportCount = 1;
-    viewportStateInfo.pViewports    = &viewport;
+    viewportStateInfo.pViewports    = nullptr;
     viewportStateInfo.scissorCount  = 1;
-    viewportStateInfo.pScissors     = &scissor;
+    viewportStateInfo.pScissors     = nullptr;
 
     VkPipelineRasterizationStateCreateInfo rasterizerInfo{};
     rasterizerInfo.sType =
     VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizerInfo.depthClampEnable        = VK_FALSE;
     rasterizerInfo.rasterizerDiscardEnable = VK_FALSE;
-    rasterizerInfo.polygonMode             = VK_POLYGON_MODE_FILL;
+    rasterizerInfo.polygonMode             = desc.polygonMode;
     rasterizerInfo.lineWidth               = 1.0f;
-    rasterizerInfo.cullMode                = VK_CULL_MODE_BACK_BIT;
-    rasterizerInfo.frontFace               = VK_FRONT_FACE_CLOCKWISE;
+    rasterizerInfo.cullMode                = desc.cullMode;
+    rasterizerInfo.frontFace               = desc.frontFace;
     rasterizerInfo.depthBiasEnable         = VK_FALSE;
     rasterizerInfo.depthBiasConstantFactor = 0.f;
     rasterizerInfo.depthBiasClamp          = 0.f;
@@ -114,13 +215,21 @@ auto createGraphicsPipeline() -> void
     multisamplingInfo.alphaToCoverageEnable = VK_FALSE;
     multisamplingInfo.alphaToOneEnable      = VK_FALSE;
 
+    VkPipelineDepthStencilStateCreateInfo depthStencilInfo{};
+    depthStencilInfo.sType =
+    VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilInfo.depthTestEnable       = desc.depthTestEnable;
+    depthStencilInfo.depthWriteEnable      = desc.depthWriteEnable;
+    depthStencilInfo.depthCompareOp        = desc.depthCompareOp;
+    depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
+    depthStencilInfo.stencilTestEnable     = VK_FALSE;
+
     VkPipelineColorBlendAttachmentState colorBlendAttachmentState{};
-    colorBlendAttachmentState.colorWriteMask =
-    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-    VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachmentState.blendEnable         = VK_FALSE;
-    colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachmentState.colorWriteMask      = desc.colorWriteMask;
+    colorBlendAttachmentState.blendEnable         = desc.blendEnable;
+    colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachmentState.dstColorBlendFactor =
+    VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
     colorBlendAttachmentState.colorBlendOp        = VK_BLEND_OP_ADD;
     colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
     colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
@@ -131,7 +240,7 @@ auto createGraphicsPipeline() -> void
     VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlendStateInfo.logicOpEnable     = VK_FALSE;
     colorBlendStateInfo.logicOp           = VK_LOGIC_OP_COPY;
-    colorBlendStateInfo.attachmentCount   = 1;
+    colorBlendStateInfo.attachmentCount   = depthOnly ? 0u : 1u;
     colorBlendStateInfo.pAttachments      = &colorBlendAttachmentState;
     colorBlendStateInfo.blendConstants[0] = 0.0f;
     colorBlendStateInfo.blendConstants[1] = 0.0f;
@@ -140,62 +249,77 @@ auto createGraphicsPipeline() -> void
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType      = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
+    pipelineInfo.stageCount = depthOnly ? 1u : 2u;
     pipelineInfo.pStages    = shaderStages;
     pipelineInfo.pVertexInputState   = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
     pipelineInfo.pViewportState      = &viewportStateInfo;
     pipelineInfo.pRasterizationState = &rasterizerInfo;
     pipelineInfo.pMultisampleState   = &multisamplingInfo;
-    pipelineInfo.pDepthStencilState  = nullptr;
+    pipelineInfo.pDepthStencilState  = &depthStencilInfo;
     pipelineInfo.pColorBlendState    = &colorBlendStateInfo;
     pipelineInfo.pDynamicState       = &dynamicStateInfos;
-    pipelineInfo.layout              = pipelineLayout;
-    pipelineInfo.renderPass          = renderPass;
-    pipelineInfo.subpass             = 0;
-    pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
-    pipelineInfo.basePipelineIndex   = -1;
+    pipelineInfo.layout =
+    desc.layout != VK_NULL_HANDLE ? desc.layout : pipelineLayout;
+    pipelineInfo.renderPass =
+    desc.renderPass != VK_NULL_HANDLE ? desc.renderPass : renderPass;
+    pipelineInfo.subpass            = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex  = -1;
 
-    if (
-    vkCreateGraphicsPipelines(
-    device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) !=
-    VK_SUCCESS) {
-        throw std::runtime_error("Failed to create Vulkan graphics pipeline.");
+    VkPipeline pipeline;
+    auto       result = vkCreateGraphicsPipelines(
+    device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+
+    destroyShaderModule(vertexShaderModule);
+    if (!depthOnly) {
+        destroyShaderModule(fragmentShaderModule);
     }
 
-    vkDestroyShaderModule(device, vertexShaderModule, nullptr);
-    vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
-
-    swapchainFramebuffers.resize(swapchainImages.size());
-
-    for (size_t i = 0; i < swapchainImageViews.size(); i++) {
-        VkImageView attachments[] = {swapchainImageViews[i]};
-
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType      = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments    = attachments;
-        framebufferInfo.width           = swapchainExtent.width;
-        framebufferInfo.height          = swapchainExtent.height;
-        framebufferInfo.layers          = 1;
-
-        if (
-        vkCreateFramebuffer(
-        device, &framebufferInfo, nullptr, &swapchainFramebuffers[i]) !=
-        VK_SUCCESS) {
-            throw std::runtime_error("failed to create framebuffer!");
-        }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan graphics pipeline.");
     }
+
+    return pipeline;
 }
 
-auto destroyGraphicsPipeline() -> void
+auto createGraphicsPipeline() -> void
 {
-    for (auto framebuffer : swapchainFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    createRenderPass();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 0;
+    pipelineLayoutInfo.pSetLayouts            = nullptr;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges    = nullptr;
+
+    if (
+    vkCreatePipelineLayout(
+    device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
     }
 
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
+    viewport.x        = 0.0f;
+    viewport.y        = 0.0f;
+    viewport.width    = (float)swapchainExtent.width;
+    viewport.height   = (float)swapchainExtent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    scissor.offset = {0, 0};
+    scissor.extent = swapchainExtent;
+
+    // Everything else may compile in the background, but nothing can be
+    // drawn without the default pipeline.
+    defaultPipeline  = requestPipeline(getDefaultPipelineDesc());
+    graphicsPipeline = waitForPipeline(defaultPipeline);
+}
+
+auto getDefaultPipeline() -> PipelineHandle { return defaultPipeline; }
+
+auto destroyGraphicsPipeline() -> void
+{
     vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
     destroyRenderPass();
 }
@@ -0,0 +1,210 @@
+#include "renderer/vulkan/pipeline_cache.hpp"
+
+#include "renderer/vulkan/global.hpp"
+#include "utils/file.hpp"
+#include "utils/hash.hpp"
+#include "utils/type.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sunset
+{
+namespace
+{
+// Our own header in front of the driver's blob. The driver validates its
+// data poorly on some platforms, so a truncated or foreign file must never
+// reach vkCreatePipelineCache.
+struct PipelineCacheFileHeader
+{
+    uint32 magic;
+    uint32 version;
+    uint32 vendorID;
+    uint32 deviceID;
+    uint32 driverVersion;
+    uint32 dataSize;
+    uint64 dataHash;
+    uint8  pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+constexpr uint32 pipelineCacheMagic   = 0x43504e53u;  // "SNPC"
+constexpr uint32 pipelineCacheVersion = 1u;
+
+std::string cachePath;
+size_t      savedDataSize = 0u;
+
+std::string                    prefetchedPath;
+std::future<std::vector<char>> prefetchedFile;
+
+auto readLittleEndian32(const char* data) -> uint32
+{
+    auto bytes = reinterpret_cast<const uint8*>(data);
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32)bytes[3] << 24;
+}
+
+auto getDeviceProperties() -> VkPhysicalDeviceProperties
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    return properties;
+}
+
+// Returns the driver blob stored in file if it was produced by this device and
+// driver, otherwise an empty span.
+auto validateCacheFile(std::span<const char> file) -> std::span<const char>
+{
+    PipelineCacheFileHeader header;
+    if (file.size() < sizeof(header)) {
+        return {};
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    auto properties = getDeviceProperties();
+    auto data       = file.data() + sizeof(header);
+
+    if (
+    header.magic != pipelineCacheMagic ||
+    header.version != pipelineCacheVersion ||
+    header.vendorID != properties.vendorID ||
+    header.deviceID != properties.deviceID ||
+    header.driverVersion != properties.driverVersion ||
+    std::memcmp(
+    header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) !=
+    0 ||
+    header.dataSize != file.size() - sizeof(header) ||
+    header.dataHash != hashBytes(data, header.dataSize)) {
+        return {};
+    }
+
+    // The blob itself starts with VkPipelineCacheHeaderVersionOne, stored
+    // least significant byte first.
+    constexpr size_t vulkanHeaderSize = 16u + VK_UUID_SIZE;
+    if (
+    header.dataSize < vulkanHeaderSize ||
+    readLittleEndian32(data) < vulkanHeaderSize ||
+    readLittleEndian32(data + 4) != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+    readLittleEndian32(data + 8) != properties.vendorID ||
+    readLittleEndian32(data + 12) != properties.deviceID ||
+    std::memcmp(data + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        return {};
+    }
+
+    return file.subspan(sizeof(header), header.dataSize);
+}
+
+auto getPipelineCacheData() -> std::vector<char>
+{
+    size_t size = 0u;
+    vkGetPipelineCacheData(device, pipelineCache, &size, nullptr);
+
+    std::vector<char> data(size);
+    vkGetPipelineCacheData(device, pipelineCache, &size, data.data());
+    data.resize(size);
+
+    return data;
+}
+}
+
+auto prefetchPipelineCache(std::string_view path) -> void
+{
+    if (std::filesystem::exists(path)) {
+        prefetchedPath = path;
+        prefetchedFile = readFileAsync(prefetchedPath);
+    }
+}
+
+auto createPipelineCache(std::string_view path) -> void
+{
+    cachePath = path;
+
+    std::vector<char> file;
+    auto              found = false;
+    if (prefetchedFile.valid() && prefetchedPath == cachePath) {
+        file  = prefetchedFile.get();
+        found = true;
+    }
+    else if (std::filesystem::exists(cachePath)) {
+        file  = readFile(cachePath);
+        found = true;
+    }
+    prefetchedFile = {};
+
+    std::span<const char> initialData;
+    if (found) {
+        initialData = validateCacheFile(file);
+
+        if (initialData.empty()) {
+            std::cerr << "Ignoring stale pipeline cache " << cachePath
+                      << std::endl;
+        }
+    }
+    savedDataSize = initialData.size();
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData    = initialData.data();
+
+    if (
+    vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan pipeline cache.");
+    }
+}
+
+auto savePipelineCache() -> void
+{
+    if (pipelineCache == VK_NULL_HANDLE || cachePath.empty()) {
+        return;
+    }
+
+    // Caches only ever grow, so an unchanged size means nothing new to write.
+    size_t size = 0u;
+    vkGetPipelineCacheData(device, pipelineCache, &size, nullptr);
+    if (size == savedDataSize) {
+        return;
+    }
+
+    auto data       = getPipelineCacheData();
+    auto properties = getDeviceProperties();
+
+    PipelineCacheFileHeader header{};
+    header.magic         = pipelineCacheMagic;
+    header.version       = pipelineCacheVersion;
+    header.vendorID      = properties.vendorID;
+    header.deviceID      = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    header.dataSize      = (uint32)data.size();
+    header.dataHash      = hashBytes(data.data(), data.size());
+    std::memcpy(
+    header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::vector<char> file(sizeof(header) + data.size());
+    std::memcpy(file.data(), &header, sizeof(header));
+    std::memcpy(file.data() + sizeof(header), data.data(), data.size());
+
+    try {
+        writeFileAtomic(cachePath, file);
+        savedDataSize = data.size();
+    }
+    catch (std::exception& e) {
+        // A cache that cannot be written only costs startup time next run.
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+auto destroyPipelineCache() -> void
+{
+    savePipelineCache();
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+    pipelineCache = VK_NULL_HANDLE;
+}
+}
@@ -0,0 +1,206 @@
+#include "renderer/vulkan/pipeline_registry.hpp"
+
+#include "renderer/vulkan/deletion_queue.hpp"
+#include "renderer/vulkan/global.hpp"
+#include "utils/job_system.hpp"
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace sunset
+{
+namespace
+{
+constexpr uint32 maxPipelines = 4096u;
+
+enum class PipelineState : uint32
+{
+    Pending,
+    Compiling,
+    Ready,
+    Failed
+};
+
+struct PipelineEntry
+{
+    PipelineDesc               desc;
+    std::atomic<VkPipeline>    pipeline{VK_NULL_HANDLE};
+    std::atomic<PipelineState> state{PipelineState::Pending};
+    // Handles of the variants requested so far, by PipelineVariant.
+    std::array<std::atomic<PipelineHandle>, pipelineVariantCount> variants;
+};
+
+// Entries are preallocated so that getPipeline can read them without taking
+// the lock while new pipelines are being requested.
+std::unique_ptr<PipelineEntry[]> entries;
+std::atomic<uint32>              entryCount{0u};
+
+std::mutex                                      registryMutex;
+std::unordered_multimap<uint64, PipelineHandle> handlesByHash;
+JobCounter                                      compileJobs;
+
+// Whoever moves the entry out of Pending compiles it, either a job or a
+// thread waiting for the pipeline.
+auto tryCompile(PipelineHandle handle) -> void
+{
+    auto& entry    = entries[handle];
+    auto  expected = PipelineState::Pending;
+    if (!entry.state.compare_exchange_strong(
+        expected, PipelineState::Compiling, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    try {
+        entry.pipeline.store(
+        buildGraphicsPipeline(entry.desc), std::memory_order_release);
+        entry.state.store(PipelineState::Ready, std::memory_order_release);
+    }
+    catch (std::exception& e) {
+        std::cerr << "Pipeline " << handle << ": " << e.what() << std::endl;
+        entry.state.store(PipelineState::Failed, std::memory_order_release);
+    }
+}
+}
+
+auto createPipelineRegistry() -> void
+{
+    entries = std::make_unique<PipelineEntry[]>(maxPipelines);
+    entryCount.store(0u);
+}
+
+auto destroyPipelineRegistry() -> void
+{
+    JobSystem::get().wait(compileJobs);
+
+    for (uint32 i = 0; i < entryCount.load(); i++) {
+        auto pipeline = entries[i].pipeline.load();
+        if (pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+    }
+
+    handlesByHash.clear();
+    entries.reset();
+    entryCount.store(0u);
+}
+
+auto requestPipeline(const PipelineDesc& desc) -> PipelineHandle
+{
+    auto hash = desc.hash();
+
+    std::unique_lock lock(registryMutex);
+
+    auto [first, last] = handlesByHash.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        if (entries[it->second].desc == desc) {
+            return it->second;
+        }
+    }
+
+    auto handle = entryCount.load(std::memory_order_relaxed);
+    if (handle == maxPipelines) {
+        throw std::runtime_error("Too many pipelines requested.");
+    }
+
+    entries[handle].desc = desc;
+    entries[handle].state.store(PipelineState::Pending);
+    for (auto& variant : entries[handle].variants) {
+        variant.store(invalidPipelineHandle, std::memory_order_relaxed);
+    }
+    entries[handle].variants[(uint32)PipelineVariant::Default].store(
+    handle, std::memory_order_relaxed);
+    entryCount.store(handle + 1, std::memory_order_release);
+    handlesByHash.emplace(hash, handle);
+
+    lock.unlock();
+
+    JobSystem::get().runInBackground(
+    [handle] { tryCompile(handle); }, &compileJobs);
+
+    return handle;
+}
+
+auto getPipeline(PipelineHandle handle) -> VkPipeline
+{
+    if (handle >= entryCount.load(std::memory_order_acquire)) {
+        return VK_NULL_HANDLE;
+    }
+
+    return entries[handle].pipeline.load(std::memory_order_acquire);
+}
+
+auto waitForPipeline(PipelineHandle handle) -> VkPipeline
+{
+    if (handle >= entryCount.load(std::memory_order_acquire)) {
+        throw std::runtime_error("Invalid pipeline handle.");
+    }
+
+    auto& entry = entries[handle];
+
+    // Compile it here rather than wait behind other queued jobs, otherwise
+    // run jobs until whoever is compiling it has finished.
+    tryCompile(handle);
+    JobSystem::get().waitUntil([&] {
+        auto state = entry.state.load(std::memory_order_acquire);
+        return state == PipelineState::Ready || state == PipelineState::Failed;
+    });
+
+    if (entry.state.load() == PipelineState::Failed) {
+        throw std::runtime_error("Failed to compile Vulkan pipeline.");
+    }
+
+    return entry.pipeline.load(std::memory_order_acquire);
+}
+
+auto getPipelineVariant(PipelineHandle handle, PipelineVariant variant)
+-> PipelineHandle
+{
+    if (handle >= entryCount.load(std::memory_order_acquire)) {
+        throw std::runtime_error("Invalid pipeline handle.");
+    }
+
+    auto& cached = entries[handle].variants[(uint32)variant];
+    auto  found  = cached.load(std::memory_order_acquire);
+    if (found != invalidPipelineHandle) {
+        return found;
+    }
+
+    // Racing threads get the same handle, requests are deduplicated.
+    found =
+    requestPipeline(getPipelineVariantDesc(entries[handle].desc, variant));
+    cached.store(found, std::memory_order_release);
+
+    return found;
+}
+
+auto reloadPipelines() -> void
+{
+    auto count = entryCount.load(std::memory_order_acquire);
+    for (PipelineHandle handle = 0; handle < count; handle++) {
+        auto& entry = entries[handle];
+
+        // Entries still pending or compiling are left to finish. Nothing but
+        // a compile writes the pipeline, and only once out of Pending.
+        auto state = entry.state.load(std::memory_order_acquire);
+        if (state != PipelineState::Ready && state != PipelineState::Failed) {
+            continue;
+        }
+
+        auto pipeline = entry.pipeline.exchange(
+        VK_NULL_HANDLE, std::memory_order_acq_rel);
+        if (pipeline != VK_NULL_HANDLE) {
+            deferDestroy(
+            [pipeline] { vkDestroyPipeline(device, pipeline, nullptr); });
+        }
+
+        entry.state.store(PipelineState::Pending, std::memory_order_release);
+        JobSystem::get().runInBackground(
+    [handle] { tryCompile(handle); }, &compileJobs);
+    }
+}
+}
@@ -11,6 +11,7 @@ auto QueueFamilyIndices::isComplete()->bool
 auto findQueueFamilies(VkPhysicalDevice device) -> QueueFamilyIndices
 {
     QueueFamilyIndices indices;
+    bool               transferIsCopyOnly = false;
 
     uint32_t queueFamilyCount = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(
@@ -20,25 +21,39 @@ auto findQueueFamilies(VkPhysicalDevice device) -> QueueFamilyIndices
     vkGetPhysicalDeviceQueueFamilyProperties(
     device, &queueFamilyCount, queueFamilies.data());
 
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+    for (uint32 i = 0; i < queueFamilyCount; i++) {
+        const auto& queueFamily = queueFamilies[i];
+
+        if (
+        !indices.graphicsFamily.has_value() &&
+        (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
             indices.graphicsFamily = i;
         }
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(
-        device, i, surface, &presentSupport);
+        // Headless rendering never presents, so any graphics queue will do.
+        VkBool32 presentSupport =
+        (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        if (surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(
+            device, i, surface, &presentSupport);
+        }
 
-        if (presentSupport) {
+        if (!indices.presentFamily.has_value() && presentSupport) {
             indices.presentFamily = i;
         }
 
-        if (indices.isComplete()) {
-            break;
+        // Compute families can always transfer even without reporting it.
+        // Prefer a pure copy engine over an async compute family.
+        auto flags    = queueFamily.queueFlags;
+        bool copyOnly = !(flags & VK_QUEUE_COMPUTE_BIT);
+        if (
+        (flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+        !(flags & VK_QUEUE_GRAPHICS_BIT) &&
+        (!indices.transferFamily.has_value() ||
+         (copyOnly && !transferIsCopyOnly))) {
+            indices.transferFamily = i;
+            transferIsCopyOnly     = copyOnly;
         }
-
-        i++;
     }
 
     return indices;
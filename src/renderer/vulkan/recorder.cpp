@@ -0,0 +1,289 @@
+#include "renderer/vulkan/recorder.hpp"
+
+#include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/instancing.hpp"
+#include "renderer/vulkan/mesh.hpp"
+#include "renderer/vulkan/pipeline_registry.hpp"
+#include "renderer/vulkan/queue.hpp"
+#include "renderer/vulkan/upload.hpp"
+#include "utils/job_system.hpp"
+#include "utils/memory.hpp"
+#include "utils/profiler.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+namespace sunset
+{
+namespace
+{
+// Below this many draws per slice the cost of a secondary command buffer and
+// the job hand-off outweighs recording on fewer threads.
+constexpr size_t minDrawsPerSlice = 512u;
+
+// Each slice is recorded by a single job at a time, whichever worker runs it.
+// Primary command buffers may be submitted again, so a slice keeps one
+// secondary buffer per frame slot, image and pipeline variant, as the depth
+// prepass and the main pass both record draws. Each pool serves a frame slot.
+// Pools belong to slices rather than worker threads: a stolen job may record
+// any slice, and a recorded buffer has to stay where a reused primary expects
+// it. Slices never outnumber threads, so the pool count is the same.
+struct RecordSlice
+{
+    std::vector<VkCommandPool>   commandPools;
+    std::vector<VkCommandBuffer> commandBuffers;
+};
+
+struct RecordJob
+{
+    const PassContext*                pass;
+    const std::vector<InstancedDraw>* draws;
+    const std::vector<uint32>*        visible;
+    PipelineVariant                   variant;
+    size_t                            sliceCount;
+};
+
+std::vector<RecordSlice> slices;
+uint32                   sliceImageCount;
+
+auto getSliceBuffer(
+const RecordSlice& slice, uint32 frameIndex, uint32 imageIndex,
+PipelineVariant variant) -> VkCommandBuffer
+{
+    auto index = frameIndex * sliceImageCount + imageIndex;
+    return slice.commandBuffers[index * pipelineVariantCount + (uint32)variant];
+}
+
+auto getSliceCount(size_t drawCount) -> size_t
+{
+    auto count = (drawCount + minDrawsPerSlice - 1) / minDrawsPerSlice;
+    return std::clamp<size_t>(count, 1u, slices.size());
+}
+
+// Secondary command buffers inherit no state, so every slice sets it up.
+auto setDynamicState(VkCommandBuffer commandBuffer, VkExtent2D extent) -> void
+{
+    auto frameViewport   = viewport;
+    frameViewport.width  = extent.width;
+    frameViewport.height = extent.height;
+    vkCmdSetViewport(commandBuffer, 0, 1, &frameViewport);
+
+    auto frameScissor   = scissor;
+    frameScissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &frameScissor);
+}
+
+// Returns false if draws were skipped because they were not ready yet.
+auto recordDrawRange(
+VkCommandBuffer commandBuffer, const InstancedDraw* draws, const uint32* first,
+const uint32* last, PipelineVariant variant) -> bool
+{
+    if (first != last && !bindInstances(commandBuffer)) {
+        return false;
+    }
+
+    auto       complete      = true;
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    MeshHandle boundMesh     = ~0u;
+    for (auto index = first; index != last; ++index) {
+        const auto* draw     = &draws[*index];
+        auto        pipeline =
+        getPipeline(getPipelineVariant(draw->pipeline, variant));
+        // Still compiling, skip it this frame.
+        if (pipeline == VK_NULL_HANDLE) {
+            complete = false;
+            continue;
+        }
+
+        const auto& mesh = getMesh(draw->mesh);
+        if (!isUploadComplete(mesh.uploadValue)) {
+            complete = false;
+            continue;
+        }
+
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(
+            commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+
+        if (draw->mesh != boundMesh) {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(
+            commandBuffer, 0, 1, &mesh.vertexBuffer.buffer, &offset);
+            vkCmdBindIndexBuffer(
+            commandBuffer, mesh.indexBuffer.buffer, 0, mesh.indexType);
+            boundMesh = draw->mesh;
+        }
+
+        vkCmdDrawIndexed(
+        commandBuffer, draw->indexCount, draw->instanceCount, draw->firstIndex,
+        0, draw->firstInstance);
+    }
+
+    return complete;
+}
+
+auto recordSlice(const RecordJob& job, size_t sliceIndex) -> bool
+{
+    PROFILE_ZONE("Record draw slice");
+
+    auto commandBuffer = getSliceBuffer(
+    slices[sliceIndex], job.pass->frameIndex, job.pass->imageIndex,
+    job.variant);
+
+    // The frame fence has been waited on, the buffer is not in use.
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass  = job.pass->renderPass;
+    inheritanceInfo.subpass     = 0;
+    inheritanceInfo.framebuffer = job.pass->framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin secondary command buffer.");
+    }
+
+    const auto& visible   = *job.visible;
+    auto        sliceSize =
+    (visible.size() + job.sliceCount - 1) / job.sliceCount;
+    auto        first     = std::min(sliceIndex * sliceSize, visible.size());
+    auto        last      = std::min(first + sliceSize, visible.size());
+
+    setDynamicState(commandBuffer, job.pass->extent);
+    auto complete = recordDrawRange(
+    commandBuffer, job.draws->data(), visible.data() + first,
+    visible.data() + last,
+    job.variant);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record secondary command buffer.");
+    }
+
+    return complete;
+}
+}
+
+auto createDrawRecorder(uint32 framesInFlight, uint32 imageCount) -> void
+{
+    auto indices = findQueueFamilies(physicalDevice);
+
+    // More slices than threads would only add secondary buffers to execute.
+    slices.resize(JobSystem::get().getThreadCount());
+    sliceImageCount = imageCount;
+
+    for (auto& slice : slices) {
+        slice.commandPools.resize(framesInFlight);
+        auto buffersPerFrame = imageCount * pipelineVariantCount;
+        slice.commandBuffers.resize(framesInFlight * buffersPerFrame);
+
+        for (uint32 i = 0; i < framesInFlight; i++) {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            poolInfo.queueFamilyIndex = indices.graphicsFamily.value();
+
+            if (
+            vkCreateCommandPool(
+            device, &poolInfo, nullptr, &slice.commandPools[i]) !=
+            VK_SUCCESS) {
+                throw std::runtime_error("Failed to create Vulkan command pool!");
+            }
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool        = slice.commandPools[i];
+            allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = buffersPerFrame;
+
+            if (
+            vkAllocateCommandBuffers(
+            device, &allocInfo, &slice.commandBuffers[i * buffersPerFrame]) !=
+            VK_SUCCESS) {
+                throw std::runtime_error(
+                "Failed to allocate secondary command buffer.");
+            }
+        }
+    }
+}
+
+auto destroyDrawRecorder() -> void
+{
+    for (auto& slice : slices) {
+        // Destroying the pools frees their command buffers.
+        for (auto commandPool : slice.commandPools) {
+            vkDestroyCommandPool(device, commandPool, nullptr);
+        }
+    }
+
+    slices.clear();
+}
+
+auto getDrawContents(size_t drawCount) -> VkSubpassContents
+{
+    return getSliceCount(drawCount) > 1
+           ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+           : VK_SUBPASS_CONTENTS_INLINE;
+}
+
+auto recordDraws(
+const PassContext& pass, const std::vector<InstancedDraw>& draws,
+const std::vector<uint32>& visible, PipelineVariant variant) -> bool
+{
+    auto sliceCount = getSliceCount(visible.size());
+
+    if (sliceCount == 1) {
+        setDynamicState(pass.commandBuffer, pass.extent);
+        return recordDrawRange(
+        pass.commandBuffer, draws.data(), visible.data(),
+        visible.data() + visible.size(), variant);
+    }
+
+    RecordJob job{&pass, &draws, &visible, variant, sliceCount};
+
+    std::atomic<bool>  complete{true};
+    std::mutex         errorMutex;
+    std::exception_ptr error;
+    JobSystem::get().parallelFor(
+    0u, sliceCount, 1u, [&](uint64 first, uint64 last) {
+        for (auto sliceIndex = first; sliceIndex != last; sliceIndex++) {
+            try {
+                if (!recordSlice(job, sliceIndex)) {
+                    complete.store(false, std::memory_order_relaxed);
+                }
+            }
+            catch (...) {
+                std::lock_guard lock(errorMutex);
+                error = std::current_exception();
+            }
+        }
+    });
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    std::pmr::vector<VkCommandBuffer> secondaries(&getFrameArena());
+    secondaries.reserve(sliceCount);
+    for (size_t i = 0; i < sliceCount; i++) {
+        secondaries.push_back(getSliceBuffer(
+        slices[i], pass.frameIndex, pass.imageIndex, variant));
+    }
+
+    vkCmdExecuteCommands(
+    pass.commandBuffer, (uint32)secondaries.size(), secondaries.data());
+
+    return complete.load();
+}
+}
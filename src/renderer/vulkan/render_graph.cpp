@@ -0,0 +1,920 @@
+#include "renderer/vulkan/render_graph.hpp"
+
+#include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/gpu_profiler.hpp"
+#include "utils/memory.hpp"
+
+#include <algorithm>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+
+namespace sunset
+{
+namespace
+{
+auto getImageAspect(VkFormat format) -> VkImageAspectFlags
+{
+    switch (format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+auto getShaderStages(PassType type) -> VkPipelineStageFlags
+{
+    switch (type) {
+        case PassType::Graphics:
+            return VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        case PassType::Compute:
+            return VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        case PassType::Transfer:
+            return VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    return 0u;
+}
+
+auto overlaps(uint32 firstA, uint32 lastA, uint32 firstB, uint32 lastB)
+-> bool
+{
+    return firstA <= lastB && firstB <= lastA;
+}
+}
+
+auto PassBuilder::writeColor(
+RenderResource image, std::optional<VkClearColorValue> clear) -> PassBuilder&
+{
+    VkClearValue clearValue{};
+    if (clear) {
+        clearValue.color = *clear;
+    }
+
+    graph->addAccess(
+    pass,
+    {image, RenderGraph::AccessKind::Color, ResourceUsage::Sampled, true,
+     clear.has_value(), clearValue});
+    return *this;
+}
+
+auto PassBuilder::writeDepth(
+RenderResource image, std::optional<VkClearDepthStencilValue> clear)
+-> PassBuilder&
+{
+    VkClearValue clearValue{};
+    if (clear) {
+        clearValue.depthStencil = *clear;
+    }
+
+    graph->addAccess(
+    pass,
+    {image, RenderGraph::AccessKind::Depth, ResourceUsage::Sampled, true,
+     clear.has_value(), clearValue});
+    return *this;
+}
+
+auto PassBuilder::readDepth(RenderResource image) -> PassBuilder&
+{
+    graph->addAccess(pass, {image, RenderGraph::AccessKind::DepthRead});
+    return *this;
+}
+
+auto PassBuilder::read(RenderResource resource, ResourceUsage usage)
+-> PassBuilder&
+{
+    graph->addAccess(
+    pass, {resource, RenderGraph::AccessKind::Usage, usage, false});
+    return *this;
+}
+
+auto PassBuilder::write(RenderResource resource, ResourceUsage usage)
+-> PassBuilder&
+{
+    if (
+    usage != ResourceUsage::StorageWrite &&
+    usage != ResourceUsage::TransferWrite) {
+        throw std::runtime_error("Render graph usage is read only.");
+    }
+
+    graph->addAccess(
+    pass, {resource, RenderGraph::AccessKind::Usage, usage, true});
+    return *this;
+}
+
+auto PassBuilder::setContents(std::function<VkSubpassContents()> contents)
+-> PassBuilder&
+{
+    graph->passes[pass].contents = std::move(contents);
+    return *this;
+}
+
+auto PassBuilder::setExecute(PassCallback execute) -> PassBuilder&
+{
+    graph->passes[pass].execute = std::move(execute);
+    return *this;
+}
+
+auto RenderGraph::importImage(const char* name, const ImportedImageDesc& desc)
+-> RenderResource
+{
+    if (desc.images.empty() || desc.images.size() != desc.views.size()) {
+        throw std::runtime_error(
+        std::string("Imported image ") + name + " needs a view per image.");
+    }
+
+    Resource resource{name, true, true};
+    resource.format        = desc.format;
+    resource.aspect        = getImageAspect(desc.format);
+    resource.extent        = desc.extent;
+    resource.images        = desc.images;
+    resource.views         = desc.views;
+    resource.initialLayout = desc.initialLayout;
+    resource.finalLayout   = desc.finalLayout;
+    resource.initialStages = desc.initialStages;
+    resource.output        = true;
+
+    resources.push_back(std::move(resource));
+    return (RenderResource)resources.size() - 1;
+}
+
+auto RenderGraph::importBuffer(
+const char* name, VkBuffer buffer, VkDeviceSize size) -> RenderResource
+{
+    Resource resource{name, false, true};
+    resource.buffer        = buffer;
+    resource.size          = size;
+    resource.initialStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+    resources.push_back(std::move(resource));
+    return (RenderResource)resources.size() - 1;
+}
+
+auto RenderGraph::createImage(const char* name, const RenderImageDesc& desc)
+-> RenderResource
+{
+    Resource resource{name, true, false};
+    resource.format = desc.format;
+    resource.aspect = getImageAspect(desc.format);
+    resource.extent = desc.extent;
+
+    resources.push_back(std::move(resource));
+    return (RenderResource)resources.size() - 1;
+}
+
+auto RenderGraph::createBuffer(const char* name, const RenderBufferDesc& desc)
+-> RenderResource
+{
+    Resource resource{name, false, false};
+    resource.size = desc.size;
+
+    resources.push_back(std::move(resource));
+    return (RenderResource)resources.size() - 1;
+}
+
+auto RenderGraph::markOutput(RenderResource resource) -> void
+{
+    resources.at(resource).output = true;
+}
+
+auto RenderGraph::addPass(const char* name, PassType type) -> PassBuilder
+{
+    passes.push_back(Pass{name, type});
+    return PassBuilder{this, (uint32)passes.size() - 1};
+}
+
+auto RenderGraph::getUsageInfo(const Access& access, PassType type)
+-> UsageInfo
+{
+    constexpr auto depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+    switch (access.kind) {
+        case AccessKind::Color:
+            return {
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+        case AccessKind::Depth:
+            return {
+            depthStages,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+        case AccessKind::DepthRead:
+            return {
+            depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+        case AccessKind::Usage:
+            break;
+    }
+
+    auto shaderStages = getShaderStages(type);
+    switch (access.usage) {
+        case ResourceUsage::Sampled:
+            return {
+            shaderStages, VK_ACCESS_SHADER_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_USAGE_SAMPLED_BIT};
+        case ResourceUsage::StorageRead:
+            return {
+            shaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+        case ResourceUsage::StorageWrite:
+            // Atomics and partial writes read too.
+            return {
+            shaderStages,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT};
+        case ResourceUsage::IndirectRead:
+            return {
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0u,
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT};
+        case ResourceUsage::VertexRead:
+            return {
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0u,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT};
+        case ResourceUsage::IndexRead:
+            return {
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, 0u, VK_BUFFER_USAGE_INDEX_BUFFER_BIT};
+        case ResourceUsage::UniformRead:
+            return {
+            shaderStages, VK_ACCESS_UNIFORM_READ_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, 0u,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT};
+        case ResourceUsage::TransferRead:
+            return {
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT};
+        case ResourceUsage::TransferWrite:
+            return {
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT};
+    }
+    return {};
+}
+
+auto RenderGraph::addAccess(uint32 pass, const Access& access) -> void
+{
+    auto& graphPass = passes[pass];
+    auto& resource  = resources.at(access.resource);
+
+    auto isAttachment = access.kind != AccessKind::Usage;
+    auto imageOnly    = isAttachment || access.usage == ResourceUsage::Sampled;
+    auto bufferOnly   = access.kind == AccessKind::Usage &&
+                      (access.usage == ResourceUsage::IndirectRead ||
+                       access.usage == ResourceUsage::VertexRead ||
+                       access.usage == ResourceUsage::IndexRead ||
+                       access.usage == ResourceUsage::UniformRead);
+
+    if (
+    (imageOnly && !resource.isImage) || (bufferOnly && resource.isImage) ||
+    (isAttachment && graphPass.type != PassType::Graphics)) {
+        throw std::runtime_error(
+        std::string("Pass ") + graphPass.name + " cannot use " +
+        resource.name + " that way.");
+    }
+
+    for (const auto& other : graphPass.accesses) {
+        if (other.resource == access.resource) {
+            throw std::runtime_error(
+            std::string("Pass ") + graphPass.name + " declares " +
+            resource.name + " twice.");
+        }
+    }
+
+    graphPass.accesses.push_back(access);
+}
+
+auto RenderGraph::compile() -> void
+{
+    cullPasses();
+    createTransients();
+    createRenderPasses();
+
+    std::vector<SyncState> slotStates(slotCount);
+    computeBarriers(slotStates);
+    computeBarriers(slotStates);
+
+    stats.passCount         = (uint32)passes.size();
+    stats.culledPassCount   = 0u;
+    stats.barrierBatchCount = 0u;
+    for (const auto& pass : passes) {
+        const auto& batch = pass.barriers;
+        if (pass.culled) {
+            stats.culledPassCount++;
+        }
+        else if (batch.srcStages != 0u || batch.dstStages != 0u) {
+            stats.barrierBatchCount++;
+        }
+    }
+    if (finalBarriers.dstStages != 0u) {
+        stats.barrierBatchCount++;
+    }
+}
+
+auto RenderGraph::cullPasses() -> void
+{
+    std::vector<bool> needed(resources.size());
+    for (size_t i = 0; i < resources.size(); i++) {
+        needed[i] = resources[i].output;
+    }
+
+    // Walking back from the outputs, a pass is needed if it writes contents
+    // a later needed pass reads. A cleared attachment does not depend on what
+    // was written to it before, anything else might.
+    for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass) {
+        pass->culled = std::none_of(
+        pass->accesses.begin(), pass->accesses.end(),
+        [&](const Access& access) {
+            return access.write && needed[access.resource];
+        });
+        if (pass->culled) {
+            continue;
+        }
+
+        for (const auto& access : pass->accesses) {
+            needed[access.resource] = !access.clear;
+        }
+    }
+
+    for (uint32 i = 0; i < passes.size(); i++) {
+        if (passes[i].culled) {
+            continue;
+        }
+
+        for (const auto& access : passes[i].accesses) {
+            auto& resource     = resources[access.resource];
+            auto  info         = getUsageInfo(access, passes[i].type);
+            resource.firstPass = std::min(resource.firstPass, i);
+            resource.lastPass  = std::max(resource.lastPass, i);
+            resource.imageUsage |= info.imageUsage;
+            resource.bufferUsage |= info.bufferUsage;
+        }
+    }
+}
+
+auto RenderGraph::createTransients() -> void
+{
+    std::vector<uint32>               transientImages;
+    std::vector<VkMemoryRequirements> requirements(resources.size());
+
+    for (uint32 i = 0; i < resources.size(); i++) {
+        auto& resource = resources[i];
+        if (resource.imported || resource.firstPass == ~0u) {
+            continue;
+        }
+
+        if (!resource.isImage) {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size        = resource.size;
+            bufferInfo.usage       = resource.bufferUsage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            if (
+            vkCreateBuffer(device, &bufferInfo, nullptr, &resource.buffer) !=
+            VK_SUCCESS) {
+                throw std::runtime_error("Failed to create graph buffer.");
+            }
+
+            resource.allocation =
+            allocateBufferMemory(resource.buffer, MemoryUsage::GpuOnly);
+            continue;
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.format        = resource.format;
+        imageInfo.extent.width  = resource.extent.width;
+        imageInfo.extent.height = resource.extent.height;
+        imageInfo.extent.depth  = 1;
+        imageInfo.mipLevels     = 1;
+        imageInfo.arrayLayers   = 1;
+        imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage         = resource.imageUsage;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        resource.images.resize(1);
+        if (
+        vkCreateImage(device, &imageInfo, nullptr, &resource.images[0]) !=
+        VK_SUCCESS) {
+            throw std::runtime_error("Failed to create graph image.");
+        }
+
+        vkGetImageMemoryRequirements(
+        device, resource.images[0], &requirements[i]);
+        transientImages.push_back(i);
+    }
+
+    // Largest first, each image goes to the first slot whose images are not
+    // in use during its passes.
+    std::sort(
+    transientImages.begin(), transientImages.end(), [&](uint32 a, uint32 b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    std::vector<VkMemoryRequirements> slotRequirements;
+    std::vector<std::vector<uint32>>  slotImages;
+    for (auto i : transientImages) {
+        auto& resource = resources[i];
+        auto& required = requirements[i];
+
+        uint32 slot = 0u;
+        for (; slot < slotImages.size(); slot++) {
+            auto compatible = (slotRequirements[slot].memoryTypeBits &
+                               required.memoryTypeBits) != 0u;
+            auto free = std::none_of(
+            slotImages[slot].begin(), slotImages[slot].end(), [&](uint32 j) {
+                return overlaps(
+                resource.firstPass, resource.lastPass, resources[j].firstPass,
+                resources[j].lastPass);
+            });
+            if (compatible && free) {
+                break;
+            }
+        }
+
+        if (slot == slotImages.size()) {
+            slotRequirements.push_back(required);
+            slotImages.emplace_back();
+        }
+
+        auto& slotRequired = slotRequirements[slot];
+        slotRequired.size  = std::max(slotRequired.size, required.size);
+        slotRequired.alignment =
+        std::max(slotRequired.alignment, required.alignment);
+        slotRequired.memoryTypeBits &= required.memoryTypeBits;
+
+        slotImages[slot].push_back(i);
+        resource.slot = slot;
+        stats.transientImageBytes += required.size;
+    }
+
+    for (uint32 slot = 0; slot < slotImages.size(); slot++) {
+        auto allocation = allocateMemory(
+        slotRequirements[slot], MemoryUsage::GpuOnly, false);
+        slotAllocations.push_back(allocation);
+        stats.transientMemoryBytes += slotRequirements[slot].size;
+
+        for (auto i : slotImages[slot]) {
+            vkBindImageMemory(
+            device, resources[i].images[0], allocation.memory,
+            allocation.offset);
+        }
+    }
+
+    for (auto i : transientImages) {
+        auto& resource = resources[i];
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image    = resource.images[0];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format   = resource.format;
+        viewInfo.subresourceRange.aspectMask = resource.aspect;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        resource.views.resize(1);
+        if (
+        vkCreateImageView(device, &viewInfo, nullptr, &resource.views[0]) !=
+        VK_SUCCESS) {
+            throw std::runtime_error("Failed to create graph image view.");
+        }
+    }
+
+    // Every other resource synchronizes on its own.
+    slotCount = (uint32)slotImages.size();
+    for (auto& resource : resources) {
+        if (resource.slot == ~0u) {
+            resource.slot = slotCount++;
+        }
+    }
+}
+
+auto RenderGraph::createRenderPasses() -> void
+{
+    for (uint32 i = 0; i < passes.size(); i++) {
+        auto& pass = passes[i];
+        if (pass.culled || pass.type != PassType::Graphics) {
+            continue;
+        }
+
+        std::vector<VkAttachmentDescription> attachments;
+        std::vector<VkAttachmentReference>   colorReferences;
+        std::vector<RenderResource>          attachmentResources;
+        VkAttachmentReference                depthReference{};
+        auto                                 hasDepth   = false;
+        size_t                               imageCount = 1u;
+
+        for (const auto& access : pass.accesses) {
+            if (access.kind == AccessKind::Usage) {
+                continue;
+            }
+
+            const auto& resource = resources[access.resource];
+            auto        layout   = getUsageInfo(access, pass.type).layout;
+
+            // Earlier contents are only loaded if something wrote them, and
+            // stored if anything still needs them.
+            auto writtenBefore =
+            (resource.imported &&
+             resource.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED) ||
+            std::any_of(passes.begin(), passes.begin() + i, [&](const Pass& p) {
+                return !p.culled &&
+                       std::any_of(
+                       p.accesses.begin(), p.accesses.end(),
+                       [&](const Access& a) {
+                           return a.resource == access.resource && a.write;
+                       });
+            });
+            auto usedAfter =
+            resource.output || resource.imported || resource.lastPass > i;
+
+            auto loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            if (access.clear) {
+                loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            }
+            else if (writtenBefore) {
+                loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+            }
+
+            VkAttachmentDescription attachment{};
+            attachment.format  = resource.format;
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp  = loadOp;
+            attachment.storeOp = usedAfter ? VK_ATTACHMENT_STORE_OP_STORE
+                                           : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            // Barriers in front of the pass do every layout transition.
+            attachment.initialLayout = layout;
+            attachment.finalLayout   = layout;
+
+            VkAttachmentReference reference{};
+            reference.attachment = (uint32)attachments.size();
+            reference.layout     = layout;
+
+            if (access.kind == AccessKind::Color) {
+                colorReferences.push_back(reference);
+            }
+            else if (hasDepth) {
+                throw std::runtime_error(
+                std::string("Pass ") + pass.name + " has two depth buffers.");
+            }
+            else {
+                depthReference = reference;
+                hasDepth       = true;
+            }
+
+            if (
+            !attachments.empty() &&
+            (resource.extent.width != pass.extent.width ||
+             resource.extent.height != pass.extent.height)) {
+                throw std::runtime_error(
+                std::string("Pass ") + pass.name +
+                " has attachments of different sizes.");
+            }
+
+            attachments.push_back(attachment);
+            attachmentResources.push_back(access.resource);
+            pass.clearValues.push_back(access.clearValue);
+            pass.extent = resource.extent;
+            imageCount  = std::max(imageCount, resource.views.size());
+        }
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = (uint32)colorReferences.size();
+        subpass.pColorAttachments    = colorReferences.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = (uint32)attachments.size();
+        renderPassInfo.pAttachments    = attachments.data();
+        renderPassInfo.subpassCount    = 1;
+        renderPassInfo.pSubpasses      = &subpass;
+
+        if (
+        vkCreateRenderPass(
+        device, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create graph render pass.");
+        }
+
+        // One framebuffer per image of imported attachments such as the
+        // swapchain.
+        pass.framebuffers.resize(imageCount);
+        for (size_t image = 0; image < imageCount; image++) {
+            std::vector<VkImageView> views;
+            for (auto resource : attachmentResources) {
+                const auto& resourceViews = resources[resource].views;
+                views.push_back(
+                resourceViews[std::min(image, resourceViews.size() - 1)]);
+            }
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass      = pass.renderPass;
+            framebufferInfo.attachmentCount = (uint32)views.size();
+            framebufferInfo.pAttachments    = views.data();
+            framebufferInfo.width           = pass.extent.width;
+            framebufferInfo.height          = pass.extent.height;
+            framebufferInfo.layers          = 1;
+
+            if (
+            vkCreateFramebuffer(
+            device, &framebufferInfo, nullptr, &pass.framebuffers[image]) !=
+            VK_SUCCESS) {
+                throw std::runtime_error("Failed to create graph framebuffer.");
+            }
+        }
+    }
+}
+
+auto RenderGraph::computeBarriers(std::vector<SyncState>& slotStates) -> void
+{
+    std::vector<SyncState> states(resources.size());
+    std::vector<bool>      used(resources.size());
+
+    for (auto& pass : passes) {
+        pass.barriers = {};
+        if (pass.culled) {
+            continue;
+        }
+
+        auto& batch = pass.barriers;
+        for (const auto& access : pass.accesses) {
+            auto& resource = resources[access.resource];
+            auto& state    = states[access.resource];
+            auto  info     = getUsageInfo(access, pass.type);
+
+            // Imported resources start out as declared. Transient ones
+            // discard their contents but wait for whatever used their memory
+            // last, earlier in the frame or in the previous frame.
+            if (!used[access.resource]) {
+                used[access.resource] = true;
+                if (resource.imported) {
+                    state             = {};
+                    state.layout      = resource.initialLayout;
+                    state.writeStages = resource.initialStages;
+                }
+                else {
+                    state        = slotStates[resource.slot];
+                    state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                }
+            }
+
+            auto layoutChange = resource.isImage && state.layout != info.layout;
+
+            VkPipelineStageFlags srcStages = 0u;
+            VkAccessFlags        srcAccess = 0u;
+            if (access.write) {
+                // Reads since the last write already waited for it.
+                srcStages = state.readStages != 0u ? state.readStages
+                                                   : state.writeStages;
+                srcAccess = state.readStages != 0u ? 0u : state.writeAccess;
+            }
+            else if (layoutChange) {
+                srcStages = state.writeStages | state.readStages;
+                srcAccess = state.writeAccess;
+            }
+            else if ((info.stages & ~state.readStages) != 0u) {
+                srcStages = state.writeStages;
+                srcAccess = state.writeAccess;
+            }
+
+            if (layoutChange || srcStages != 0u) {
+                batch.srcStages |= srcStages;
+                batch.dstStages |= info.stages;
+
+                if (resource.isImage) {
+                    batch.imageBarriers.push_back(
+                    {access.resource, state.layout, info.layout, srcAccess,
+                     info.access});
+                }
+                else if (srcAccess != 0u) {
+                    batch.srcMemoryAccess |= srcAccess;
+                    batch.dstMemoryAccess |= info.access;
+                }
+            }
+
+            if (access.write) {
+                state.writeStages = info.stages;
+                state.writeAccess = info.access;
+                state.readStages  = 0u;
+            }
+            else if (layoutChange) {
+                state.readStages = info.stages;
+            }
+            else {
+                state.readStages |= info.stages;
+            }
+            state.layout = info.layout;
+
+            if (!resource.imported) {
+                slotStates[resource.slot] = state;
+            }
+        }
+    }
+
+    // Imported images are left as their owner expects them.
+    finalBarriers = {};
+    for (uint32 i = 0; i < resources.size(); i++) {
+        const auto& resource = resources[i];
+        if (!resource.imported || !resource.isImage) {
+            continue;
+        }
+
+        auto state = states[i];
+        if (!used[i]) {
+            state             = {};
+            state.layout      = resource.initialLayout;
+            state.writeStages = resource.initialStages;
+        }
+
+        if (state.layout != resource.finalLayout) {
+            finalBarriers.srcStages |= state.writeStages | state.readStages;
+            finalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            finalBarriers.imageBarriers.push_back(
+            {i, state.layout, resource.finalLayout, state.writeAccess, 0u});
+        }
+    }
+}
+
+auto RenderGraph::recordBarriers(
+VkCommandBuffer commandBuffer, const BarrierBatch& batch,
+uint32 imageIndex) const -> void
+{
+    if (batch.srcStages == 0u && batch.dstStages == 0u) {
+        return;
+    }
+
+    std::pmr::vector<VkImageMemoryBarrier> imageBarriers(&getFrameArena());
+    imageBarriers.reserve(batch.imageBarriers.size());
+    for (const auto& barrier : batch.imageBarriers) {
+        const auto& resource = resources[barrier.resource];
+
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask       = barrier.srcAccess;
+        imageBarrier.dstAccessMask       = barrier.dstAccess;
+        imageBarrier.oldLayout           = barrier.oldLayout;
+        imageBarrier.newLayout           = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = getImage(barrier.resource, imageIndex);
+        imageBarrier.subresourceRange.aspectMask = resource.aspect;
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.layerCount = 1;
+        imageBarriers.push_back(imageBarrier);
+    }
+
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = batch.srcMemoryAccess;
+    memoryBarrier.dstAccessMask = batch.dstMemoryAccess;
+    auto hasMemoryBarrier =
+    batch.srcMemoryAccess != 0u || batch.dstMemoryAccess != 0u;
+
+    vkCmdPipelineBarrier(
+    commandBuffer,
+    batch.srcStages != 0u ? batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+    batch.dstStages != 0u ? batch.dstStages
+                          : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+    0, hasMemoryBarrier ? 1u : 0u, &memoryBarrier, 0, nullptr,
+    (uint32)imageBarriers.size(), imageBarriers.data());
+}
+
+auto RenderGraph::execute(
+VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIndex) -> bool
+{
+    auto complete = true;
+    for (auto& pass : passes) {
+        if (pass.culled) {
+            continue;
+        }
+
+        recordBarriers(commandBuffer, pass.barriers, imageIndex);
+        auto zone = beginGpuZone(commandBuffer, pass.name);
+
+        PassContext context{commandBuffer, frameIndex, imageIndex};
+        if (pass.type == PassType::Graphics) {
+            context.renderPass  = pass.renderPass;
+            context.framebuffer = pass.framebuffers[std::min<size_t>(
+            imageIndex, pass.framebuffers.size() - 1)];
+            context.extent      = pass.extent;
+
+            VkRenderPassBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            beginInfo.renderPass        = context.renderPass;
+            beginInfo.framebuffer       = context.framebuffer;
+            beginInfo.renderArea.extent = pass.extent;
+            beginInfo.clearValueCount   = (uint32)pass.clearValues.size();
+            beginInfo.pClearValues      = pass.clearValues.data();
+
+            vkCmdBeginRenderPass(
+            commandBuffer, &beginInfo,
+            pass.contents ? pass.contents() : VK_SUBPASS_CONTENTS_INLINE);
+        }
+
+        if (pass.execute && !pass.execute(context)) {
+            complete = false;
+        }
+
+        if (pass.type == PassType::Graphics) {
+            vkCmdEndRenderPass(commandBuffer);
+        }
+        endGpuZone(commandBuffer, zone);
+    }
+
+    recordBarriers(commandBuffer, finalBarriers, imageIndex);
+
+    return complete;
+}
+
+auto RenderGraph::destroy() -> void
+{
+    for (auto& pass : passes) {
+        for (auto framebuffer : pass.framebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+        if (pass.renderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(device, pass.renderPass, nullptr);
+        }
+    }
+
+    for (auto& resource : resources) {
+        if (resource.imported) {
+            continue;
+        }
+
+        for (auto view : resource.views) {
+            vkDestroyImageView(device, view, nullptr);
+        }
+        for (auto image : resource.images) {
+            vkDestroyImage(device, image, nullptr);
+        }
+        if (resource.buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, resource.buffer, nullptr);
+            freeMemory(resource.allocation);
+        }
+    }
+
+    for (auto& allocation : slotAllocations) {
+        freeMemory(allocation);
+    }
+
+    resources.clear();
+    passes.clear();
+    slotAllocations.clear();
+    finalBarriers = {};
+    slotCount     = 0u;
+    stats         = {};
+}
+
+auto RenderGraph::getImage(RenderResource resource, uint32 imageIndex) const
+-> VkImage
+{
+    const auto& images = resources[resource].images;
+    return images[std::min<size_t>(imageIndex, images.size() - 1)];
+}
+
+auto RenderGraph::getImageView(
+RenderResource resource, uint32 imageIndex) const -> VkImageView
+{
+    const auto& views = resources[resource].views;
+    return views[std::min<size_t>(imageIndex, views.size() - 1)];
+}
+
+auto RenderGraph::getBuffer(RenderResource resource) const -> VkBuffer
+{
+    return resources[resource].buffer;
+}
+
+auto RenderGraph::getStats() const -> const RenderGraphStats&
+{
+    return stats;
+}
+}
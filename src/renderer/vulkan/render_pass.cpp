@@ -1,5 +1,6 @@
 #include "renderer/vulkan/render_pass.hpp"
 
+#include "renderer/vulkan/device.hpp"
 #include "renderer/vulkan/global.hpp"
 
 #include <vulkan/vulkan.h>
@@ -10,6 +11,11 @@ namespace sunset
 {
 auto createRenderPass() -> void
 {
+    depthFormat = findDepthFormat();
+
+    // Only formats, sample counts and attachment order matter for
+    // compatibility, load ops, layouts and dependencies come from the render
+    // graph.
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format         = swapchainImageFormat;
     colorAttachment.samples        = VK_SAMPLE_COUNT_1_BIT;
@@ -18,43 +24,70 @@ auto createRenderPass() -> void
     colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout    = swapchainImageLayout;
+
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format         = depthFormat;
+    depthAttachment.samples        = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout =
+    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout =
+    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments    = &colorAttachmentRef;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass    = 0;
-    dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount    = 1;
+    subpass.pColorAttachments       = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    VkAttachmentDescription attachments[] = {colorAttachment, depthAttachment};
 
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments    = &colorAttachment;
+    renderPassInfo.attachmentCount = 2;
+    renderPassInfo.pAttachments    = attachments;
     renderPassInfo.subpassCount    = 1;
     renderPassInfo.pSubpasses      = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies   = &dependency;
 
     if (
     vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) !=
     VK_SUCCESS) {
         throw std::runtime_error("Failed to create Vulkan render pass");
     }
+
+    depthAttachmentRef.attachment = 0;
+
+    VkSubpassDescription depthSubpass{};
+    depthSubpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    depthSubpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments    = &depthAttachment;
+    renderPassInfo.pSubpasses      = &depthSubpass;
+
+    if (
+    vkCreateRenderPass(
+    device, &renderPassInfo, nullptr, &depthPrepassRenderPass) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan render pass");
+    }
 }
 
 auto destroyRenderPass() -> void
 {
+    vkDestroyRenderPass(device, depthPrepassRenderPass, nullptr);
     vkDestroyRenderPass(device, renderPass, nullptr);
 }
 }
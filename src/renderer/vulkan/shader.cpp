@@ -1,19 +1,48 @@
+#include "renderer/vulkan/embedded_shaders.hpp"
 #include "renderer/vulkan/global.hpp"
 #include "renderer/vulkan/shader.hpp"
+#include "renderer/vulkan/shader_compiler.hpp"
 #include "utils/file.hpp"
 
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace sunset
 {
-auto createShaderModule(std::string_view shaderPath) -> VkShaderModule
+auto createShaderModule(
+std::string_view shader, std::span<const std::string> defines)
+-> VkShaderModule
 {
-    auto code = readFile(shaderPath);
+    std::span<const uint32> code;
+    std::vector<uint32>     compiled;
+    MappedFile              file;
+    if (defines.empty()) {
+        code = findEmbeddedShader(shader);
+    }
+
+    if (code.empty() && isGlslShader(shader)) {
+        compiled = compileShader(shader, defines);
+        code     = compiled;
+    }
+    else if (code.empty()) {
+        // Mappings are page aligned, so the words can be read in place.
+        file       = MappedFile(shader);
+        auto bytes = file.getData();
+        if (bytes.empty() || bytes.size() % sizeof(uint32) != 0) {
+            throw std::runtime_error(
+            "Invalid SPIR-V in " + std::string(shader) + ".");
+        }
+
+        code = {
+        reinterpret_cast<const uint32*>(bytes.data()),
+        bytes.size() / sizeof(uint32)};
+    }
 
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode    = reinterpret_cast<const uint32_t*>(code.data());
+    createInfo.codeSize = code.size_bytes();
+    createInfo.pCode    = code.data();
 
     VkShaderModule shaderModule;
     if (
@@ -0,0 +1,309 @@
+#include "renderer/vulkan/shader_compiler.hpp"
+
+#include "utils/file.hpp"
+#include "utils/hash.hpp"
+#include "utils/profiler.hpp"
+
+#ifdef SUNSET_SHADERC
+#include <shaderc/shaderc.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace sunset
+{
+namespace
+{
+constexpr std::array<std::string_view, 7> glslExtensions{
+".vert", ".frag", ".comp", ".geom", ".tesc", ".tese", ".glsl"};
+
+#ifdef SUNSET_SHADERC
+// Bump when anything but the source and the compiler changes the output.
+constexpr uint32 shaderCacheVersion = 1u;
+constexpr uint32 spirvMagic         = 0x07230203u;
+
+// The build system passes the version of the shaderc it links against, a
+// new compiler may generate different code for the same source.
+#ifndef SUNSET_SHADERC_VERSION
+#define SUNSET_SHADERC_VERSION "unknown"
+#endif
+constexpr std::string_view compilerVersion = SUNSET_SHADERC_VERSION;
+
+#ifdef DEBUG
+constexpr bool debugInfo         = true;
+constexpr auto optimizationLevel = shaderc_optimization_level_zero;
+#else
+constexpr bool debugInfo         = false;
+constexpr auto optimizationLevel = shaderc_optimization_level_performance;
+#endif
+
+using CompileOptions = std::unique_ptr<
+shaderc_compile_options, decltype(&shaderc_compile_options_release)>;
+using CompileResult = std::unique_ptr<
+shaderc_compilation_result, decltype(&shaderc_result_release)>;
+
+struct IncludeResult
+{
+    shaderc_include_result result;
+    std::string            name;
+    std::string            content;
+};
+
+shaderc_compiler_t    compiler = nullptr;
+std::filesystem::path cacheDirectory;
+// Pipelines sharing a shader may compile it at the same time, only one of
+// them may write the cache file.
+std::mutex cacheWriteMutex;
+
+auto getShaderKind(std::string_view path) -> shaderc_shader_kind
+{
+    auto extension = std::filesystem::path(path).extension();
+    if (extension == ".vert") {
+        return shaderc_vertex_shader;
+    }
+    if (extension == ".frag") {
+        return shaderc_fragment_shader;
+    }
+    if (extension == ".comp") {
+        return shaderc_compute_shader;
+    }
+    if (extension == ".geom") {
+        return shaderc_geometry_shader;
+    }
+    if (extension == ".tesc") {
+        return shaderc_tess_control_shader;
+    }
+    if (extension == ".tese") {
+        return shaderc_tess_evaluation_shader;
+    }
+    return shaderc_glsl_infer_from_source;
+}
+
+// Quoted includes are relative to the including file, angled ones to the
+// directory of the shader being compiled.
+auto resolveInclude(
+void* userData, const char* requestedSource, int type,
+const char* requestingSource, size_t) -> shaderc_include_result*
+{
+    auto root      = static_cast<const std::filesystem::path*>(userData);
+    auto directory = type == shaderc_include_type_relative ?
+                     std::filesystem::path(requestingSource).parent_path() :
+                     *root;
+    auto path      = (directory / requestedSource).lexically_normal();
+
+    auto include = new IncludeResult{};
+    try {
+        auto data = readFile(path.string());
+        include->name = path.generic_string();
+        include->content.assign(data.begin(), data.end());
+    }
+    catch (std::exception& e) {
+        // An empty name tells the compiler the content is an error message.
+        include->content = e.what();
+    }
+
+    include->result.source_name        = include->name.c_str();
+    include->result.source_name_length = include->name.size();
+    include->result.content            = include->content.c_str();
+    include->result.content_length     = include->content.size();
+    include->result.user_data          = include;
+
+    return &include->result;
+}
+
+auto releaseInclude(void*, shaderc_include_result* result) -> void
+{
+    delete static_cast<IncludeResult*>(result->user_data);
+}
+
+auto checkResult(const CompileResult& result, std::string_view path) -> void
+{
+    if (
+    shaderc_result_get_compilation_status(result.get()) !=
+    shaderc_compilation_status_success) {
+        throw std::runtime_error(
+        "Failed to compile " + std::string(path) + ":\n" +
+        shaderc_result_get_error_message(result.get()));
+    }
+}
+
+auto getCacheKey(std::string_view preprocessed, shaderc_shader_kind kind)
+-> uint64
+{
+    auto key = hashString(preprocessed);
+    key      = hashValue(kind, key);
+    key      = hashString(compilerVersion, key);
+    key      = hashValue(optimizationLevel, key);
+    key      = hashValue(debugInfo, key);
+    key      = hashValue(shaderCacheVersion, key);
+
+    return key;
+}
+
+auto getCachePath(uint64 key) -> std::filesystem::path
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)key);
+    return cacheDirectory / name;
+}
+
+// Empty if the entry is missing or is not SPIR-V.
+auto readCachedShader(const std::filesystem::path& path)
+-> std::vector<uint32>
+{
+    if (!std::filesystem::exists(path)) {
+        return {};
+    }
+
+    MappedFile file(path.string());
+    auto       bytes = file.getData();
+    if (bytes.size() < sizeof(uint32) || bytes.size() % sizeof(uint32) != 0) {
+        return {};
+    }
+
+    std::vector<uint32> code(bytes.size() / sizeof(uint32));
+    std::memcpy(code.data(), bytes.data(), bytes.size());
+    if (code[0] != spirvMagic) {
+        return {};
+    }
+
+    return code;
+}
+
+auto writeCachedShader(
+const std::filesystem::path& path, const std::vector<uint32>& code) -> void
+{
+    std::vector<char> data(code.size() * sizeof(uint32));
+    std::memcpy(data.data(), code.data(), data.size());
+
+    try {
+        std::lock_guard lock(cacheWriteMutex);
+        writeFileAtomic(path.string(), data);
+    }
+    catch (std::exception& e) {
+        // A cache that cannot be written only costs compile time next run.
+        std::cerr << e.what() << std::endl;
+    }
+}
+#endif
+}
+
+auto isGlslShader(std::string_view path) -> bool
+{
+    auto extension = std::filesystem::path(path).extension().string();
+    for (auto glslExtension : glslExtensions) {
+        if (extension == glslExtension) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#ifdef SUNSET_SHADERC
+auto createShaderCompiler(std::string_view directory) -> void
+{
+    compiler = shaderc_compiler_initialize();
+    if (compiler == nullptr) {
+        throw std::runtime_error("Failed to initialize shaderc.");
+    }
+    cacheDirectory = directory;
+}
+
+auto destroyShaderCompiler() -> void
+{
+    shaderc_compiler_release(compiler);
+    compiler = nullptr;
+}
+
+auto compileShader(std::string_view path, std::span<const std::string> defines)
+-> std::vector<uint32>
+{
+    PROFILE_ZONE("Compile shader");
+
+    if (compiler == nullptr) {
+        throw std::runtime_error("The shader compiler was not created.");
+    }
+
+    auto source = readFile(path);
+    auto name   = std::string(path);
+    auto root   = std::filesystem::path(path).parent_path();
+    auto kind   = getShaderKind(path);
+
+    CompileOptions options(
+    shaderc_compile_options_initialize(), shaderc_compile_options_release);
+    for (const auto& define : defines) {
+        auto separator = std::min(define.find('='), define.size());
+        auto value     = separator < define.size() ?
+                         std::string_view(define).substr(separator + 1) :
+                         std::string_view();
+        shaderc_compile_options_add_macro_definition(
+        options.get(), define.data(), separator, value.data(), value.size());
+    }
+    shaderc_compile_options_set_target_env(
+    options.get(), shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    if (debugInfo) {
+        shaderc_compile_options_set_generate_debug_info(options.get());
+    }
+    shaderc_compile_options_set_optimization_level(
+    options.get(), optimizationLevel);
+    shaderc_compile_options_set_include_callbacks(
+    options.get(), resolveInclude, releaseInclude, &root);
+
+    // Preprocessing resolves includes and defines for a fraction of the cost
+    // of a compile, and the result is exactly what decides the output.
+    CompileResult preprocessed(
+    shaderc_compile_into_preprocessed_text(
+    compiler, source.data(), source.size(), kind, name.c_str(), "main",
+    options.get()),
+    shaderc_result_release);
+    checkResult(preprocessed, path);
+
+    std::string_view text(
+    shaderc_result_get_bytes(preprocessed.get()),
+    shaderc_result_get_length(preprocessed.get()));
+
+    auto cachePath = getCachePath(getCacheKey(text, kind));
+    if (auto code = readCachedShader(cachePath); !code.empty()) {
+        return code;
+    }
+
+    CompileResult compiled(
+    shaderc_compile_into_spv(
+    compiler, text.data(), text.size(), kind, name.c_str(), "main",
+    options.get()),
+    shaderc_result_release);
+    checkResult(compiled, path);
+
+    std::vector<uint32> code(
+    shaderc_result_get_length(compiled.get()) / sizeof(uint32));
+    std::memcpy(
+    code.data(), shaderc_result_get_bytes(compiled.get()),
+    code.size() * sizeof(uint32));
+
+    writeCachedShader(cachePath, code);
+
+    return code;
+}
+#else
+auto createShaderCompiler(std::string_view) -> void {}
+
+auto destroyShaderCompiler() -> void {}
+
+auto compileShader(std::string_view path, std::span<const std::string>)
+-> std::vector<uint32>
+{
+    throw std::runtime_error(
+    "Cannot compile " + std::string(path) +
+    ", GLSL needs a build with the shaderc option.");
+}
+#endif
+}
@@ -2,18 +2,23 @@
 
 #include "renderer/vulkan/global.hpp"
 #include "renderer/vulkan/queue.hpp"
+#include "utils/memory.hpp"
 #include "utils/type.hpp"
 
 #include <algorithm>
 #include <limits>
+#include <span>
 #include <stdexcept>
 
 namespace sunset
 {
-auto getSwapchainSupportDetails(VkPhysicalDevice device)
+auto getSwapchainSupportDetails(
+VkPhysicalDevice device, std::pmr::memory_resource* resource)
 -> SwapchainSupportDetails
 {
-    SwapchainSupportDetails details;
+    SwapchainSupportDetails details{
+    {}, std::pmr::vector<VkSurfaceFormatKHR>(resource),
+    std::pmr::vector<VkPresentModeKHR>(resource)};
 
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
     device, surface, &details.capabilities);
@@ -42,7 +47,7 @@ auto getSwapchainSupportDetails(VkPhysicalDevice device)
 }
 
 auto chooseSwapSurfaceFormat(
-const std::vector<VkSurfaceFormatKHR>& availableFormats) -> VkSurfaceFormatKHR
+std::span<const VkSurfaceFormatKHR> availableFormats) -> VkSurfaceFormatKHR
 {
     for (const auto& availableFormat : availableFormats) {
         if (
@@ -56,17 +61,62 @@ const std::vector<VkSurfaceFormatKHR>& availableFormats) -> VkSurfaceFormatKHR
 }
 
 auto chooseSwapPresentMode(
-const std::vector<VkPresentModeKHR>& availablePresentModes) -> VkPresentModeKHR
+std::span<const VkPresentModeKHR> availablePresentModes, PresentPolicy policy)
+-> VkPresentModeKHR
 {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
+    static constexpr VkPresentModeKHR lowLatencyModes[] = {
+    VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+    static constexpr VkPresentModeKHR balancedModes[] = {
+    VK_PRESENT_MODE_MAILBOX_KHR};
+
+    std::span<const VkPresentModeKHR> preferredModes;
+    switch (policy) {
+        case PresentPolicy::LowLatency:
+            preferredModes = lowLatencyModes;
+            break;
+        case PresentPolicy::Balanced:
+            preferredModes = balancedModes;
+            break;
+        case PresentPolicy::Throughput:
+            break;
+    }
+
+    for (auto preferredMode : preferredModes) {
+        if (
+        std::find(
+        availablePresentModes.begin(), availablePresentModes.end(),
+        preferredMode) != availablePresentModes.end()) {
+            return preferredMode;
         }
     }
 
+    // The only mode every implementation has to support.
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+auto chooseSwapImageCount(
+const VkSurfaceCapabilitiesKHR& capabilities, PresentPolicy policy) -> uint32
+{
+    uint32 imageCount = capabilities.minImageCount;
+    switch (policy) {
+        case PresentPolicy::LowLatency:
+            break;
+        case PresentPolicy::Balanced:
+            imageCount += 1;
+            break;
+        case PresentPolicy::Throughput:
+            imageCount += 2;
+            break;
+    }
+
+    if (
+    capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+
+    return imageCount;
+}
+
 VkExtent2D chooseSwapExtent(
 uint32 width, uint32 height, const VkSurfaceCapabilitiesKHR& capabilities)
 {
@@ -88,24 +138,20 @@ uint32 width, uint32 height, const VkSurfaceCapabilitiesKHR& capabilities)
     }
 }
 
-auto createSwapchain(uint32 width, uint32 height) -> void
+auto createSwapchain(uint32 width, uint32 height, PresentPolicy policy)
+-> void
 {
     SwapchainSupportDetails swapchainSupport =
-    getSwapchainSupportDetails(physicalDevice);
+    getSwapchainSupportDetails(physicalDevice, &getFrameArena());
 
     VkSurfaceFormatKHR surfaceFormat =
     chooseSwapSurfaceFormat(swapchainSupport.formats);
     VkPresentModeKHR presentMode =
-    chooseSwapPresentMode(swapchainSupport.presentModes);
+    chooseSwapPresentMode(swapchainSupport.presentModes, policy);
     VkExtent2D extent =
     chooseSwapExtent(width, height, swapchainSupport.capabilities);
-
-    uint32 imageCount = swapchainSupport.capabilities.minImageCount + 1;
-    if (
-    swapchainSupport.capabilities.maxImageCount > 0 &&
-    imageCount > swapchainSupport.capabilities.maxImageCount) {
-        imageCount = swapchainSupport.capabilities.maxImageCount;
-    }
+    uint32 imageCount =
+    chooseSwapImageCount(swapchainSupport.capabilities, policy);
 
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType            = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -136,7 +182,7 @@ auto createSwapchain(uint32 width, uint32 height) -> void
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode    = presentMode;
     createInfo.clipped        = VK_TRUE;
-    createInfo.oldSwapchain   = VK_NULL_HANDLE;
+    createInfo.oldSwapchain   = swapchain;
 
     if (
     vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain) !=
@@ -151,6 +197,7 @@ auto createSwapchain(uint32 width, uint32 height) -> void
     device, swapchain, &imageCount, swapchainImages.data());
 
     swapchainImageFormat = surfaceFormat.format;
+    swapchainImageLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     swapchainExtent      = extent;
 
     for (size_t i = 0; i < swapchainImages.size(); i++) {
@@ -179,11 +226,13 @@ auto createSwapchain(uint32 width, uint32 height) -> void
 
 auto destroySwapchain() -> void
 {
-
     for (auto imageView : swapchainImageViews) {
         vkDestroyImageView(device, imageView, nullptr);
     }
 
+    swapchainImageViews.clear();
+
     vkDestroySwapchainKHR(device, swapchain, nullptr);
+    swapchain = VK_NULL_HANDLE;
 }
 }
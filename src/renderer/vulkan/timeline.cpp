@@ -0,0 +1,259 @@
+#include "renderer/vulkan/timeline.hpp"
+
+#include "renderer/vulkan/device.hpp"
+#include "renderer/vulkan/global.hpp"
+#include "utils/memory.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+namespace sunset
+{
+namespace
+{
+struct PendingFence
+{
+    uint64  value;
+    VkFence fence;
+};
+
+struct TimelineState
+{
+    VkQueue     queue          = VK_NULL_HANDLE;
+    VkSemaphore semaphore      = VK_NULL_HANDLE;
+    uint64      submittedValue = 0u;
+    // Last value seen complete, so polling below it needs no driver call.
+    uint64 completedValue = 0u;
+    // Fallback without timeline semaphores, one fence per submission.
+    std::deque<PendingFence> pendingFences;
+};
+
+std::array<TimelineState, timelineCount> timelines;
+std::vector<VkFence>                     freeFences;
+bool                                     useSemaphores;
+
+auto getState(Timeline timeline) -> TimelineState&
+{
+    return timelines[(uint32)timeline];
+}
+
+auto getFreeFence() -> VkFence
+{
+    VkFence fence;
+    if (!freeFences.empty()) {
+        fence = freeFences.back();
+        freeFences.pop_back();
+        vkResetFences(device, 1, &fence);
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan fence.");
+    }
+
+    return fence;
+}
+
+// Fences are only trusted in submission order, so a later fence signaling
+// never completes an earlier value on its own.
+auto retireSignaledFences(TimelineState& state) -> void
+{
+    while (
+    !state.pendingFences.empty() &&
+    vkGetFenceStatus(device, state.pendingFences.front().fence) ==
+    VK_SUCCESS) {
+        state.completedValue = state.pendingFences.front().value;
+        freeFences.push_back(state.pendingFences.front().fence);
+        state.pendingFences.pop_front();
+    }
+}
+
+auto submitWithSemaphore(
+TimelineState& state, const VkSubmitInfo& submitInfo, uint64 value)
+-> VkResult
+{
+    auto& arena = getFrameArena();
+
+    std::pmr::vector<VkSemaphore> signalSemaphores(
+    submitInfo.pSignalSemaphores,
+    submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount, &arena);
+    signalSemaphores.push_back(state.semaphore);
+
+    // Binary semaphores ignore their entries in the value array.
+    std::pmr::vector<uint64> signalValues(
+    submitInfo.signalSemaphoreCount, 0u, &arena);
+    signalValues.push_back(value);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = submitInfo.pNext;
+    timelineInfo.signalSemaphoreValueCount = (uint32)signalValues.size();
+    timelineInfo.pSignalSemaphoreValues    = signalValues.data();
+
+    auto timelineSubmit                 = submitInfo;
+    timelineSubmit.pNext                = &timelineInfo;
+    timelineSubmit.signalSemaphoreCount = (uint32)signalSemaphores.size();
+    timelineSubmit.pSignalSemaphores    = signalSemaphores.data();
+
+    return vkQueueSubmit(state.queue, 1, &timelineSubmit, VK_NULL_HANDLE);
+}
+
+auto submitWithFence(
+TimelineState& state, const VkSubmitInfo& submitInfo, uint64 value)
+-> VkResult
+{
+    auto fence  = getFreeFence();
+    auto result = vkQueueSubmit(state.queue, 1, &submitInfo, fence);
+    if (result != VK_SUCCESS) {
+        freeFences.push_back(fence);
+        return result;
+    }
+
+    state.pendingFences.push_back({value, fence});
+
+    return result;
+}
+}
+
+auto createTimelines() -> void
+{
+    useSemaphores = isTimelineSemaphoreEnabled();
+
+    getState(Timeline::Graphics).queue = graphicsQueue;
+    getState(Timeline::Transfer).queue = transferQueue;
+
+    for (auto& state : timelines) {
+        state.submittedValue = 0u;
+        state.completedValue = 0u;
+
+        if (!useSemaphores) {
+            continue;
+        }
+
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue  = 0u;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (
+        vkCreateSemaphore(device, &semaphoreInfo, nullptr, &state.semaphore) !=
+        VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Vulkan timeline.");
+        }
+    }
+}
+
+auto destroyTimelines() -> void
+{
+    for (auto& state : timelines) {
+        if (state.semaphore != VK_NULL_HANDLE) {
+            vkDestroySemaphore(device, state.semaphore, nullptr);
+            state.semaphore = VK_NULL_HANDLE;
+        }
+
+        for (auto& pending : state.pendingFences) {
+            vkWaitForFences(device, 1, &pending.fence, VK_TRUE, UINT64_MAX);
+            vkDestroyFence(device, pending.fence, nullptr);
+        }
+        state.pendingFences.clear();
+    }
+
+    for (auto fence : freeFences) {
+        vkDestroyFence(device, fence, nullptr);
+    }
+    freeFences.clear();
+}
+
+auto submitToTimeline(Timeline timeline, const VkSubmitInfo& submitInfo)
+-> uint64
+{
+    auto& state = getState(timeline);
+    auto  value = state.submittedValue + 1;
+
+    auto result = useSemaphores ? submitWithSemaphore(state, submitInfo, value)
+                                : submitWithFence(state, submitInfo, value);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit Vulkan command buffer.");
+    }
+
+    state.submittedValue = value;
+
+    return value;
+}
+
+auto getSubmittedValue(Timeline timeline) -> uint64
+{
+    return getState(timeline).submittedValue;
+}
+
+auto getCompletedValue(Timeline timeline) -> uint64
+{
+    auto& state = getState(timeline);
+    if (useSemaphores) {
+        vkGetSemaphoreCounterValue(
+        device, state.semaphore, &state.completedValue);
+    }
+    else {
+        retireSignaledFences(state);
+    }
+
+    return state.completedValue;
+}
+
+auto isValueComplete(Timeline timeline, uint64 value) -> bool
+{
+    return value <= getState(timeline).completedValue ||
+           value <= getCompletedValue(timeline);
+}
+
+auto waitForValue(Timeline timeline, uint64 value) -> void
+{
+    if (isValueComplete(timeline, value)) {
+        return;
+    }
+
+    auto& state = getState(timeline);
+    if (value > state.submittedValue) {
+        throw std::runtime_error("Waiting for a value never submitted.");
+    }
+
+    if (useSemaphores) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores    = &state.semaphore;
+        waitInfo.pValues        = &value;
+
+        if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to wait for Vulkan timeline.");
+        }
+
+        state.completedValue = std::max(state.completedValue, value);
+        return;
+    }
+
+    std::pmr::vector<VkFence> fences(&getFrameArena());
+    for (const auto& pending : state.pendingFences) {
+        if (pending.value > value) {
+            break;
+        }
+        fences.push_back(pending.fence);
+    }
+
+    vkWaitForFences(
+    device, (uint32)fences.size(), fences.data(), VK_TRUE, UINT64_MAX);
+    retireSignaledFences(state);
+}
+}
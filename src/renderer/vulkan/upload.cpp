@@ -0,0 +1,404 @@
+#include "renderer/vulkan/upload.hpp"
+
+#include "renderer/vulkan/global.hpp"
+#include "renderer/vulkan/queue.hpp"
+#include "renderer/vulkan/timeline.hpp"
+#include "utils/memory.hpp"
+#include "utils/profiler.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+namespace sunset
+{
+namespace
+{
+constexpr VkDeviceSize ringAlignment = 16;
+
+struct PendingCopy
+{
+    VkBuffer             buffer;
+    VkBufferCopy         region;
+    VkPipelineStageFlags dstStage;
+    VkAccessFlags        dstAccess;
+};
+
+struct UploadBatch
+{
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    // Transfer timeline value signaled when the copies complete.
+    uint64 value = 0u;
+    // Ring bytes, including wrap padding, released when the batch retires.
+    VkDeviceSize ringBytes = 0;
+    // Destination buffers, acquired by the graphics queue once retired.
+    std::vector<VkBuffer> buffers;
+    VkPipelineStageFlags  dstStages   = 0;
+    VkAccessFlags         dstAccesses = 0;
+};
+
+uint32        graphicsFamily;
+uint32        transferFamily;
+VkCommandPool transferCommandPool;
+
+Buffer       ring;
+VkDeviceSize ringHead;
+VkDeviceSize ringTail;
+VkDeviceSize ringUsed;
+VkDeviceSize pendingRingBytes;
+
+std::vector<PendingCopy> pendingCopies;
+std::deque<UploadBatch>  inFlightBatches;
+std::vector<UploadBatch> freeBatches;
+
+// Retired batches whose barriers have not been recorded yet.
+std::vector<UploadBatch> retiredBatches;
+
+uint64 acquiredValue;
+
+auto isOwnershipTransfer() -> bool { return graphicsFamily != transferFamily; }
+
+auto retireOldestBatch() -> void
+{
+    auto batch = std::move(inFlightBatches.front());
+    inFlightBatches.pop_front();
+
+    ringTail = (ringTail + batch.ringBytes) % ring.size;
+    ringUsed -= batch.ringBytes;
+
+    retiredBatches.push_back(std::move(batch));
+}
+
+auto retireFinishedBatches() -> void
+{
+    while (
+    !inFlightBatches.empty() &&
+    isValueComplete(Timeline::Transfer, inFlightBatches.front().value)) {
+        retireOldestBatch();
+    }
+}
+
+auto waitForOldestBatch() -> void
+{
+    PROFILE_ZONE("Wait for upload ring");
+
+    waitForValue(Timeline::Transfer, inFlightBatches.front().value);
+    retireOldestBatch();
+}
+
+auto tryAllocateRing(VkDeviceSize size, VkDeviceSize& offset) -> bool
+{
+    if (ringUsed == 0) {
+        ringHead = 0;
+        ringTail = 0;
+    }
+
+    if (ringUsed == ring.size) {
+        return false;
+    }
+
+    if (ringHead >= ringTail) {
+        if (ringHead + size <= ring.size) {
+            offset = ringHead;
+            ringHead += size;
+            ringUsed += size;
+            pendingRingBytes += size;
+            return true;
+        }
+
+        // Wrap around, padding out the end of the ring.
+        if (size <= ringTail) {
+            auto padding = ring.size - ringHead;
+            offset       = 0;
+            ringHead     = size;
+            ringUsed += padding + size;
+            pendingRingBytes += padding + size;
+            return true;
+        }
+
+        return false;
+    }
+
+    if (ringHead + size <= ringTail) {
+        offset = ringHead;
+        ringHead += size;
+        ringUsed += size;
+        pendingRingBytes += size;
+        return true;
+    }
+
+    return false;
+}
+
+auto allocateRing(VkDeviceSize size) -> VkDeviceSize
+{
+    size = (size + ringAlignment - 1) / ringAlignment * ringAlignment;
+
+    VkDeviceSize offset;
+    while (!tryAllocateRing(size, offset)) {
+        if (!pendingCopies.empty()) {
+            submitUploads();
+        }
+
+        if (inFlightBatches.empty()) {
+            throw std::runtime_error("Upload does not fit the staging ring.");
+        }
+
+        waitForOldestBatch();
+    }
+
+    return offset;
+}
+
+auto getFreeBatch() -> UploadBatch
+{
+    if (!freeBatches.empty()) {
+        auto batch = std::move(freeBatches.back());
+        freeBatches.pop_back();
+
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+        batch.buffers.clear();
+        batch.dstStages   = 0;
+        batch.dstAccesses = 0;
+
+        return batch;
+    }
+
+    UploadBatch batch;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = transferCommandPool;
+    allocInfo.level       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    if (
+    vkAllocateCommandBuffers(device, &allocInfo, &batch.commandBuffer) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan upload batch.");
+    }
+
+    return batch;
+}
+}
+
+auto createUploadContext(VkDeviceSize ringSize) -> void
+{
+    auto indices   = findQueueFamilies(physicalDevice);
+    graphicsFamily = indices.graphicsFamily.value();
+    transferFamily = indices.transferFamily.value_or(graphicsFamily);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = transferFamily;
+
+    if (
+    vkCreateCommandPool(device, &poolInfo, nullptr, &transferCommandPool) !=
+    VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Vulkan command pool!");
+    }
+
+    ring = createBuffer(
+    ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsage::CpuToGpu);
+
+    ringHead         = 0;
+    ringTail         = 0;
+    ringUsed         = 0;
+    pendingRingBytes = 0;
+    acquiredValue    = 0u;
+}
+
+auto destroyUploadContext() -> void
+{
+    waitForValue(Timeline::Transfer, getSubmittedValue(Timeline::Transfer));
+
+    inFlightBatches.clear();
+    retiredBatches.clear();
+    freeBatches.clear();
+    pendingCopies.clear();
+
+    // Destroying the pool frees the batch command buffers.
+    vkDestroyCommandPool(device, transferCommandPool, nullptr);
+    destroyBuffer(ring);
+}
+
+auto uploadBuffer(
+const Buffer& buffer, VkDeviceSize offset, const void* data,
+VkDeviceSize size, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+-> uint64
+{
+    // Split uploads so that a single one never needs more than half the
+    // ring, the other half can still be in flight.
+    auto maxChunk = ring.size / 2 / ringAlignment * ringAlignment;
+    auto bytes    = static_cast<const char*>(data);
+
+    for (VkDeviceSize copied = 0; copied < size;) {
+        auto chunk      = std::min(size - copied, maxChunk);
+        auto ringOffset = allocateRing(chunk);
+
+        std::memcpy(
+        static_cast<char*>(ring.allocation.mapped) + ringOffset,
+        bytes + copied, chunk);
+        flushAllocation(ring.allocation, ringOffset, chunk);
+
+        PendingCopy copy;
+        copy.buffer           = buffer.buffer;
+        copy.region.srcOffset = ringOffset;
+        copy.region.dstOffset = offset + copied;
+        copy.region.size      = chunk;
+        copy.dstStage         = dstStage;
+        copy.dstAccess        = dstAccess;
+        pendingCopies.push_back(copy);
+
+        copied += chunk;
+    }
+
+    return getSubmittedValue(Timeline::Transfer) + 1;
+}
+
+auto submitUploads() -> void
+{
+    if (pendingCopies.empty()) {
+        return;
+    }
+
+    PROFILE_ZONE("Submit uploads");
+
+    auto batch       = getFreeBatch();
+    batch.ringBytes  = pendingRingBytes;
+    pendingRingBytes = 0;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+    // One vkCmdCopyBuffer per destination, with all of its regions.
+    std::stable_sort(
+    pendingCopies.begin(), pendingCopies.end(),
+    [](const auto& a, const auto& b) { return a.buffer < b.buffer; });
+
+    std::pmr::vector<VkBufferCopy> regions(&getFrameArena());
+    for (size_t first = 0; first < pendingCopies.size();) {
+        auto buffer = pendingCopies[first].buffer;
+
+        regions.clear();
+        auto last = first;
+        while (
+        last < pendingCopies.size() && pendingCopies[last].buffer == buffer) {
+            regions.push_back(pendingCopies[last].region);
+            batch.dstStages |= pendingCopies[last].dstStage;
+            batch.dstAccesses |= pendingCopies[last].dstAccess;
+            last++;
+        }
+
+        vkCmdCopyBuffer(
+        batch.commandBuffer, ring.buffer, buffer, (uint32)regions.size(),
+        regions.data());
+        batch.buffers.push_back(buffer);
+
+        first = last;
+    }
+
+    // Exclusive buffers written on another queue family have to be released
+    // here and acquired again on the graphics queue before use.
+    if (isOwnershipTransfer()) {
+        std::pmr::vector<VkBufferMemoryBarrier> releases(&getFrameArena());
+        for (auto buffer : batch.buffers) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.srcQueueFamilyIndex = transferFamily;
+            barrier.dstQueueFamilyIndex = graphicsFamily;
+            barrier.buffer              = buffer;
+            barrier.offset              = 0;
+            barrier.size                = VK_WHOLE_SIZE;
+            releases.push_back(barrier);
+        }
+
+        vkCmdPipelineBarrier(
+        batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+        (uint32)releases.size(), releases.data(), 0, nullptr);
+    }
+
+    vkEndCommandBuffer(batch.commandBuffer);
+    pendingCopies.clear();
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &batch.commandBuffer;
+
+    batch.value = submitToTimeline(Timeline::Transfer, submitInfo);
+    inFlightBatches.push_back(std::move(batch));
+}
+
+auto acquireUploads(VkCommandBuffer commandBuffer) -> void
+{
+    retireFinishedBatches();
+
+    if (retiredBatches.empty()) {
+        return;
+    }
+
+    // The host saw the batch values complete before this command buffer is
+    // submitted, which orders the copies before these barriers.
+    VkPipelineStageFlags                    dstStages = 0;
+    VkMemoryBarrier                         barrier{};
+    std::pmr::vector<VkBufferMemoryBarrier> acquires(&getFrameArena());
+
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    for (auto& batch : retiredBatches) {
+        dstStages |= batch.dstStages;
+        barrier.dstAccessMask |= batch.dstAccesses;
+
+        if (isOwnershipTransfer()) {
+            for (auto buffer : batch.buffers) {
+                VkBufferMemoryBarrier acquire{};
+                acquire.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                acquire.srcAccessMask       = 0;
+                acquire.dstAccessMask       = batch.dstAccesses;
+                acquire.srcQueueFamilyIndex = transferFamily;
+                acquire.dstQueueFamilyIndex = graphicsFamily;
+                acquire.buffer              = buffer;
+                acquire.offset              = 0;
+                acquire.size                = VK_WHOLE_SIZE;
+                acquires.push_back(acquire);
+            }
+        }
+
+        acquiredValue = std::max(acquiredValue, batch.value);
+        freeBatches.push_back(std::move(batch));
+    }
+    retiredBatches.clear();
+
+    if (isOwnershipTransfer()) {
+        vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0, 0,
+        nullptr, (uint32)acquires.size(), acquires.data(), 0, nullptr);
+    }
+    else {
+        vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 1,
+        &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+auto hasUploadsToAcquire() -> bool
+{
+    retireFinishedBatches();
+
+    return !retiredBatches.empty();
+}
+
+auto isUploadComplete(uint64 value) -> bool { return value <= acquiredValue; }
+}
@@ -1,25 +1,302 @@
 #include "utils/file.hpp"
-#include "utils/type.hpp"
+#include "utils/profiler.hpp"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 
 namespace sunset
 {
-std::vector<char> readFile(std::string_view path)
+namespace
+{
+struct FileRead
+{
+    std::string                     path;
+    std::promise<std::vector<char>> promise;
+};
+
+std::mutex               readMutex;
+std::condition_variable  readCondition;
+std::deque<FileRead>     reads;
+std::vector<std::thread> readers;
+bool                     stopReaders = false;
+
+auto serveRead(FileRead& read) -> void
+{
+    PROFILE_ZONE("Read file");
+
+    try {
+        read.promise.set_value(readFile(read.path));
+    }
+    catch (...) {
+        read.promise.set_exception(std::current_exception());
+    }
+}
+
+auto readerLoop(uint32 index) -> void
+{
+    Profiler::get().setThreadName("File reader " + std::to_string(index));
+
+    while (true) {
+        std::unique_lock lock(readMutex);
+        readCondition.wait(lock, [] { return stopReaders || !reads.empty(); });
+        if (reads.empty()) {
+            return;
+        }
+
+        auto read = std::move(reads.front());
+        reads.pop_front();
+        lock.unlock();
+
+        serveRead(read);
+    }
+}
+}
+
+auto readFile(std::string_view path) -> std::vector<char>
 {
-    std::ifstream file(path.data(), std::ios::ate | std::ios::binary);
+    std::ifstream file(std::string(path), std::ios::ate | std::ios::binary);
 
     if (!file.is_open()) {
-        throw std::runtime_error("Failed to open " + std::string(path.data()));
+        throw std::runtime_error("Failed to open " + std::string(path));
     }
 
-    uint32            size = file.tellg();
-    std::vector<char> buffer(size);
+    auto end = file.tellg();
+    if (end < 0) {
+        throw std::runtime_error("Failed to size " + std::string(path));
+    }
+
+    std::vector<char> buffer((size_t)end);
 
     file.seekg(0);
-    file.read(buffer.data(), size);
+    file.read(buffer.data(), (std::streamsize)buffer.size());
+
+    if (!file.good()) {
+        throw std::runtime_error("Failed to read " + std::string(path));
+    }
 
     return buffer;
 }
+
+auto writeFileAtomic(std::string_view path, const std::vector<char>& data)
+-> void
+{
+    std::filesystem::path target(path);
+    std::filesystem::path temporary(target);
+    temporary += ".tmp";
+
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path());
+    }
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + temporary.string());
+        }
+
+        file.write(data.data(), data.size());
+
+        if (!file.good()) {
+            throw std::runtime_error("Failed to write " + temporary.string());
+        }
+    }
+
+    std::filesystem::rename(temporary, target);
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(std::string_view path)
+{
+    auto file = CreateFileA(
+    std::string(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open " + std::string(path));
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to size " + std::string(path));
+    }
+
+    // Mapping an empty file fails, there is nothing to map anyway.
+    size = (size_t)fileSize.QuadPart;
+    if (size == 0u) {
+        CloseHandle(file);
+        return;
+    }
+
+    // The mapping keeps the file open, the handle is not needed any more.
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw std::runtime_error("Failed to map " + std::string(path));
+    }
+
+    data = static_cast<const char*>(
+    MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        throw std::runtime_error("Failed to map " + std::string(path));
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<char*>(data), size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+auto MappedFile::unmap() -> void
+{
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+    }
+
+    data    = nullptr;
+    size    = 0u;
+    mapping = nullptr;
+}
+#else
+MappedFile::MappedFile(std::string_view path)
+{
+    auto file = open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        throw std::runtime_error("Failed to open " + std::string(path));
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        close(file);
+        throw std::runtime_error("Failed to size " + std::string(path));
+    }
+
+    // Mapping an empty file fails, there is nothing to map anyway.
+    size = (size_t)status.st_size;
+    if (size == 0u) {
+        close(file);
+        return;
+    }
+
+    // The mapping keeps the file open, the descriptor is not needed any more.
+    auto address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (address == MAP_FAILED) {
+        size = 0u;
+        throw std::runtime_error("Failed to map " + std::string(path));
+    }
+
+    data = static_cast<const char*>(address);
+    madvise(address, size, MADV_WILLNEED);
+}
+
+auto MappedFile::unmap() -> void
+{
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    data = nullptr;
+    size = 0u;
+}
+#endif
+
+MappedFile::~MappedFile() { unmap(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+#ifdef _WIN32
+        std::swap(mapping, other.mapping);
+#endif
+    }
+
+    return *this;
+}
+
+auto MappedFile::getData() const -> std::span<const char>
+{
+    return {data, size};
+}
+
+auto createFileReaders(uint32 threadCount) -> void
+{
+    stopReaders = false;
+    for (uint32 i = 0; i < threadCount; i++) {
+        readers.emplace_back(readerLoop, i);
+    }
+}
+
+auto destroyFileReaders() -> void
+{
+    {
+        std::lock_guard lock(readMutex);
+        stopReaders = true;
+    }
+    readCondition.notify_all();
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    readers.clear();
+}
+
+auto readFileAsync(std::string path) -> std::future<std::vector<char>>
+{
+    return std::move(readFilesAsync({&path, 1u}).front());
+}
+
+auto readFilesAsync(std::span<const std::string> paths)
+-> std::vector<std::future<std::vector<char>>>
+{
+    std::vector<std::future<std::vector<char>>> futures;
+    futures.reserve(paths.size());
+
+    std::deque<FileRead> batch;
+    for (const auto& path : paths) {
+        auto& read = batch.emplace_back(FileRead{path, {}});
+        futures.push_back(read.promise.get_future());
+    }
+
+    if (readers.empty()) {
+        for (auto& read : batch) {
+            serveRead(read);
+        }
+        return futures;
+    }
+
+    {
+        std::lock_guard lock(readMutex);
+        for (auto& read : batch) {
+            reads.push_back(std::move(read));
+        }
+    }
+    readCondition.notify_all();
+
+    return futures;
+}
 }
@@ -0,0 +1,43 @@
+#include "utils/frame_limiter.hpp"
+
+#include <thread>
+
+namespace sunset
+{
+namespace
+{
+// Sleeps are only trusted up to this close to the deadline.
+constexpr auto spinMargin = std::chrono::microseconds(1500);
+}
+
+auto FrameLimiter::setTargetRate(float64 framesPerSecond) -> void
+{
+    interval = Clock::duration::zero();
+    if (framesPerSecond > 0.0) {
+        interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float64>(1.0 / framesPerSecond));
+    }
+    deadline = Clock::now();
+}
+
+auto FrameLimiter::wait() -> void
+{
+    if (interval == Clock::duration::zero()) {
+        return;
+    }
+
+    auto now = Clock::now();
+    if (deadline - now > spinMargin) {
+        std::this_thread::sleep_until(deadline - spinMargin);
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+
+    now = Clock::now();
+    deadline += interval;
+    if (deadline < now) {
+        deadline = now + interval;
+    }
+}
+}
@@ -0,0 +1,303 @@
+#include "utils/job_system.hpp"
+
+#include "utils/profiler.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace sunset
+{
+namespace
+{
+constexpr uint32 noWorker = ~0u;
+
+thread_local uint32 currentWorker = noWorker;
+}
+
+auto JobDeque::push(Job* job) -> bool
+{
+    auto b = bottom.load(std::memory_order_relaxed);
+    auto t = top.load(std::memory_order_acquire);
+    if (b - t >= capacity) {
+        return false;
+    }
+
+    jobs[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+auto JobDeque::pop() -> Job*
+{
+    auto b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    auto job = jobs[b & (capacity - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Last job, race the thieves for it.
+        if (!top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+auto JobDeque::steal() -> Job*
+{
+    auto t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+        return nullptr;
+    }
+
+    auto job = jobs[t & (capacity - 1)].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(
+        t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    return job;
+}
+
+auto JobSystem::start(uint32 workerCount) -> void
+{
+    if (workerCount == autoWorkerCount) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1u;
+    }
+
+    stopping.store(false);
+    workers.resize(workerCount + 1u);
+    for (auto& worker : workers) {
+        worker          = std::make_unique<Worker>();
+        worker->jobPool = std::make_unique<std::array<Job, jobPoolSize>>();
+    }
+
+    currentWorker = 0u;
+    for (uint32 i = 1; i < workers.size(); i++) {
+        workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+    }
+}
+
+auto JobSystem::stop() -> void
+{
+    // Drain whatever is still queued so no counter is left waiting.
+    waitUntil([this] { return queuedJobs.load() == 0; });
+
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping.store(true);
+    }
+    wakeUp.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    workers.clear();
+    currentWorker = noWorker;
+}
+
+auto JobSystem::getThreadCount() const -> uint32
+{
+    return std::max<uint32>((uint32)workers.size(), 1u);
+}
+
+auto JobSystem::wait(const JobCounter& counter) -> void
+{
+    waitUntil([&] { return counter.isDone(); });
+}
+
+auto JobSystem::allocateJob() -> Job*
+{
+    // Pool slots are reused round robin. A busy slot may belong to a job
+    // further down this very stack, so never wait on one, skip it instead.
+    if (currentWorker != noWorker) {
+        auto& worker = *workers[currentWorker];
+        for (uint32 i = 0; i < jobPoolSize; i++) {
+            auto& job = (*worker.jobPool)[worker.nextJob++ % jobPoolSize];
+            if (job.free.load(std::memory_order_acquire)) {
+                job.free.store(false, std::memory_order_relaxed);
+                return &job;
+            }
+        }
+    }
+
+    auto job           = new Job;
+    job->heapAllocated = true;
+    job->free.store(false, std::memory_order_relaxed);
+    return job;
+}
+
+auto JobSystem::submit(Job* job) -> void
+{
+    queuedJobs.fetch_add(1);
+
+    if (currentWorker != noWorker) {
+        if (!workers[currentWorker]->deque.push(job)) {
+            queuedJobs.fetch_sub(1);
+            execute(job);
+            return;
+        }
+    }
+    else {
+        std::lock_guard lock(injectMutex);
+        injectedJobs.push_back(job);
+        injectedCount.fetch_add(1);
+    }
+
+    notifySleepingWorker();
+}
+
+auto JobSystem::submitInBackground(Job* job) -> void
+{
+    queuedJobs.fetch_add(1);
+
+    {
+        std::lock_guard lock(backgroundMutex);
+        backgroundJobs.push_back(job);
+        backgroundCount.fetch_add(1);
+    }
+
+    notifySleepingWorker();
+}
+
+auto JobSystem::notifySleepingWorker() -> void
+{
+    // Only background workers sleep, so whichever wakes may run the job.
+    if (sleepingWorkers.load() > 0u) {
+        std::lock_guard lock(sleepMutex);
+        wakeUp.notify_one();
+    }
+}
+
+auto JobSystem::tryRunJob() -> bool
+{
+    auto job = findJob();
+    if (job == nullptr) {
+        return false;
+    }
+
+    queuedJobs.fetch_sub(1);
+    execute(job);
+
+    return true;
+}
+
+auto JobSystem::findJob() -> Job*
+{
+    if (workers.empty()) {
+        return nullptr;
+    }
+
+    auto self = currentWorker;
+    if (self != noWorker) {
+        if (auto job = workers[self]->deque.pop()) {
+            return job;
+        }
+    }
+
+    if (injectedCount.load(std::memory_order_relaxed) > 0u) {
+        std::lock_guard lock(injectMutex);
+        if (!injectedJobs.empty()) {
+            auto job = injectedJobs.front();
+            injectedJobs.pop_front();
+            injectedCount.fetch_sub(1);
+            return job;
+        }
+    }
+
+    // Start with the next worker so thieves spread over the victims.
+    auto count = (uint32)workers.size();
+    auto first = self == noWorker ? 0u : self + 1u;
+    for (uint32 i = 0; i < count; i++) {
+        auto victim = (first + i) % count;
+        if (victim == self) {
+            continue;
+        }
+
+        if (auto job = workers[victim]->deque.steal()) {
+            return job;
+        }
+    }
+
+    // Long jobs last, and never on worker 0 or threads outside the system,
+    // which only run jobs while waiting on their own.
+    if (
+    self != noWorker && self != 0u &&
+    backgroundCount.load(std::memory_order_relaxed) > 0u) {
+        std::lock_guard lock(backgroundMutex);
+        if (!backgroundJobs.empty()) {
+            auto job = backgroundJobs.front();
+            backgroundJobs.pop_front();
+            backgroundCount.fetch_sub(1);
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+auto JobSystem::execute(Job* job) -> void
+{
+    if (job->dependency != nullptr) {
+        waitUntil([job] { return job->dependency->isDone(); });
+    }
+
+    job->invoke(*job);
+
+    auto counter = job->counter;
+    if (job->heapAllocated) {
+        delete job;
+    }
+    else {
+        job->free.store(true, std::memory_order_release);
+    }
+
+    if (counter != nullptr) {
+        counter->value.fetch_sub(1u, std::memory_order_acq_rel);
+    }
+}
+
+auto JobSystem::workerLoop(uint32 index) -> void
+{
+    currentWorker = index;
+    Profiler::get().setThreadName("Worker " + std::to_string(index));
+
+    uint32 idleSpins = 0u;
+    while (!stopping.load(std::memory_order_relaxed)) {
+        if (tryRunJob()) {
+            idleSpins = 0u;
+            continue;
+        }
+
+        if (++idleSpins < 64u) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        sleepingWorkers.fetch_add(1);
+        wakeUp.wait(lock, [this] {
+            return stopping.load() || queuedJobs.load() > 0;
+        });
+        sleepingWorkers.fetch_sub(1);
+        idleSpins = 0u;
+    }
+}
+}
@@ -0,0 +1,181 @@
+#include "utils/memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace sunset
+{
+namespace
+{
+std::unique_ptr<LinearArena> frameArena;
+std::atomic<uint64>          heapAllocationCount{0u};
+
+// Every block has to hold a free list link and stay aligned.
+auto getPoolBlockSize(size_t size) -> size_t
+{
+    constexpr size_t alignment = alignof(std::max_align_t);
+
+    size = std::max(size, sizeof(void*));
+    return (size + alignment - 1) / alignment * alignment;
+}
+}
+}
+
+#ifdef DEBUG
+// The array and nothrow forms call these by default, so replacing the plain
+// forms counts every allocation but the over-aligned ones.
+auto operator new(std::size_t size) -> void*
+{
+    sunset::heapAllocationCount.fetch_add(1u, std::memory_order_relaxed);
+
+    if (auto p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+auto operator delete(void* p) noexcept -> void { std::free(p); }
+
+auto operator delete(void* p, std::size_t) noexcept -> void { std::free(p); }
+#endif
+
+namespace sunset
+{
+LinearArena::LinearArena(size_t capacity, std::pmr::memory_resource* upstream)
+    : block(std::make_unique<std::byte[]>(capacity)),
+      capacity(capacity),
+      upstream(upstream)
+{}
+
+auto LinearArena::reset() -> void
+{
+    used          = 0u;
+    overflowCount = 0u;
+}
+
+auto LinearArena::getCapacity() const -> size_t { return capacity; }
+
+auto LinearArena::getUsed() const -> size_t { return used; }
+
+auto LinearArena::getOverflowCount() const -> uint32 { return overflowCount; }
+
+auto LinearArena::do_allocate(size_t bytes, size_t alignment) -> void*
+{
+    auto base    = reinterpret_cast<std::uintptr_t>(block.get());
+    auto aligned = (base + used + alignment - 1) & ~(alignment - 1);
+    auto offset  = aligned - base;
+
+    if (offset + bytes <= capacity) {
+        used = offset + bytes;
+        return block.get() + offset;
+    }
+
+    overflowCount++;
+    return upstream->allocate(bytes, alignment);
+}
+
+auto LinearArena::do_deallocate(void* p, size_t bytes, size_t alignment)
+-> void
+{
+    auto bytePointer = static_cast<std::byte*>(p);
+    if (bytePointer >= block.get() && bytePointer < block.get() + capacity) {
+        return;
+    }
+
+    upstream->deallocate(p, bytes, alignment);
+}
+
+auto LinearArena::do_is_equal(
+const std::pmr::memory_resource& other) const noexcept -> bool
+{
+    return this == &other;
+}
+
+PoolResource::PoolResource(
+size_t blockSize, size_t blocksPerChunk, std::pmr::memory_resource* upstream)
+    : blockSize(getPoolBlockSize(blockSize)),
+      blocksPerChunk(std::max<size_t>(blocksPerChunk, 1u)),
+      upstream(upstream)
+{}
+
+PoolResource::~PoolResource()
+{
+    for (auto chunk : chunks) {
+        upstream->deallocate(
+        chunk, blockSize * blocksPerChunk, alignof(std::max_align_t));
+    }
+}
+
+auto PoolResource::getBlockSize() const -> size_t { return blockSize; }
+
+auto PoolResource::getBlocksInUse() const -> size_t { return blocksInUse; }
+
+auto PoolResource::do_allocate(size_t bytes, size_t alignment) -> void*
+{
+    if (bytes > blockSize || alignment > alignof(std::max_align_t)) {
+        return upstream->allocate(bytes, alignment);
+    }
+
+    if (freeBlocks == nullptr) {
+        addChunk();
+    }
+
+    auto block = freeBlocks;
+    freeBlocks = block->next;
+    blocksInUse++;
+
+    return block;
+}
+
+auto PoolResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+-> void
+{
+    if (bytes > blockSize || alignment > alignof(std::max_align_t)) {
+        upstream->deallocate(p, bytes, alignment);
+        return;
+    }
+
+    auto block  = static_cast<FreeBlock*>(p);
+    block->next = freeBlocks;
+    freeBlocks  = block;
+    blocksInUse--;
+}
+
+auto PoolResource::do_is_equal(
+const std::pmr::memory_resource& other) const noexcept -> bool
+{
+    return this == &other;
+}
+
+auto PoolResource::addChunk() -> void
+{
+    auto chunk = static_cast<std::byte*>(upstream->allocate(
+    blockSize * blocksPerChunk, alignof(std::max_align_t)));
+    chunks.push_back(chunk);
+
+    // Linked back to front so blocks are handed out in address order.
+    for (auto i = blocksPerChunk; i-- > 0;) {
+        auto block  = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+        block->next = freeBlocks;
+        freeBlocks  = block;
+    }
+}
+
+auto createFrameArena(size_t capacity) -> void
+{
+    frameArena = std::make_unique<LinearArena>(capacity);
+}
+
+auto destroyFrameArena() -> void { frameArena.reset(); }
+
+auto getFrameArena() -> LinearArena& { return *frameArena; }
+
+auto getHeapAllocationCount() -> uint64
+{
+    return heapAllocationCount.load(std::memory_order_relaxed);
+}
+}
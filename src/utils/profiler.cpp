@@ -0,0 +1,206 @@
+#include "utils/profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace sunset
+{
+namespace
+{
+auto steadyNanoseconds() -> uint64
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+auto writeJsonString(std::ofstream& file, std::string_view str) -> void
+{
+    file << '"';
+    for (auto c : str) {
+        switch (c) {
+            case '"': file << "\\\""; break;
+            case '\\': file << "\\\\"; break;
+            case '\n': file << "\\n"; break;
+            default: file << c; break;
+        }
+    }
+    file << '"';
+}
+
+auto writeEvents(
+std::ofstream& file, const std::vector<ProfileEvent>& events, uint32 pid,
+uint32 tid, bool& first) -> void
+{
+    char buffer[128];
+
+    for (const auto& event : events) {
+        file << (first ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(file, event.name);
+        std::snprintf(
+        buffer, sizeof(buffer),
+        ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u,",
+        event.begin / 1000.0, (event.end - event.begin) / 1000.0, pid, tid);
+        file << buffer << "\"args\":{\"frame\":" << event.frame << "}}";
+        first = false;
+    }
+}
+
+auto writeMetadata(
+std::ofstream& file, const char* type, std::string_view name, uint32 pid,
+uint32 tid, bool& first) -> void
+{
+    file << (first ? "\n" : ",\n") << "{\"name\":\"" << type
+         << "\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+         << ",\"args\":{\"name\":";
+    writeJsonString(file, name);
+    file << "}}";
+    first = false;
+}
+}
+
+auto ProfileEventRing::push(const ProfileEvent& event) -> void
+{
+    auto index               = head.load(std::memory_order_relaxed);
+    events[index % capacity] = event;
+    head.store(index + 1, std::memory_order_release);
+}
+
+auto ProfileEventRing::snapshot() const -> std::vector<ProfileEvent>
+{
+    auto end   = head.load(std::memory_order_acquire);
+    auto begin = end > capacity ? end - capacity : 0u;
+
+    std::vector<ProfileEvent> copy;
+    copy.reserve(end - begin);
+    for (auto i = begin; i < end; i++) {
+        copy.push_back(events[i % capacity]);
+    }
+
+    // Anything the writer lapped while we were copying may be torn, and so
+    // may the slot of the event it is writing now.
+    auto after   = head.load(std::memory_order_acquire);
+    auto overrun = after + 1 > begin + capacity
+                   ? after + 1 - begin - capacity
+                   : 0u;
+    copy.erase(
+    copy.begin(), copy.begin() + std::min<uint64>(overrun, copy.size()));
+
+    return copy;
+}
+
+Profiler::Profiler() : epoch(steadyNanoseconds())
+{
+    gpuRing.threadId   = 0u;
+    gpuRing.threadName = "GPU";
+}
+
+auto Profiler::now() const -> uint64 { return steadyNanoseconds() - epoch; }
+
+auto Profiler::beginFrame(uint64 frameNumber) -> void
+{
+    frame.store(frameNumber, std::memory_order_relaxed);
+}
+
+auto Profiler::currentFrame() const -> uint64
+{
+    return frame.load(std::memory_order_relaxed);
+}
+
+auto Profiler::threadRing() -> ProfileEventRing&
+{
+    thread_local ProfileEventRing* ring = nullptr;
+
+    if (ring == nullptr) {
+        std::lock_guard lock(ringsMutex);
+        rings.push_back(std::make_unique<ProfileEventRing>());
+        ring             = rings.back().get();
+        ring->threadId   = (uint32)rings.size();
+        ring->threadName = "Thread " + std::to_string(ring->threadId);
+    }
+
+    return *ring;
+}
+
+auto Profiler::setThreadName(std::string_view name) -> void
+{
+    auto& ring = threadRing();
+
+    std::lock_guard lock(ringsMutex);
+    ring.threadName = name;
+}
+
+auto Profiler::recordCpu(const char* name, uint64 begin, uint64 end) -> void
+{
+    threadRing().push({name, begin, end, currentFrame()});
+}
+
+auto Profiler::recordGpu(
+const char* name, uint64 begin, uint64 end, uint64 frameNumber) -> void
+{
+    gpuRing.push({name, begin, end, frameNumber});
+}
+
+auto Profiler::cpuEvents() -> std::vector<ProfileEvent>
+{
+    std::vector<ProfileEvent> events;
+
+    std::lock_guard lock(ringsMutex);
+    for (const auto& ring : rings) {
+        auto ringEvents = ring->snapshot();
+        events.insert(events.end(), ringEvents.begin(), ringEvents.end());
+    }
+
+    return events;
+}
+
+auto Profiler::gpuEvents() -> std::vector<ProfileEvent>
+{
+    return gpuRing.snapshot();
+}
+
+auto Profiler::writeChromeTrace(std::string_view path) -> void
+{
+    std::ofstream file(std::string(path), std::ios::trunc);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + std::string(path));
+    }
+
+    constexpr uint32 cpuPid = 0u;
+    constexpr uint32 gpuPid = 1u;
+
+    bool first = true;
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    writeMetadata(file, "process_name", "CPU", cpuPid, 0u, first);
+    writeMetadata(file, "process_name", "GPU", gpuPid, 0u, first);
+    {
+        std::lock_guard lock(ringsMutex);
+        for (const auto& ring : rings) {
+            writeMetadata(
+            file, "thread_name", ring->threadName, cpuPid, ring->threadId,
+            first);
+            writeEvents(file, ring->snapshot(), cpuPid, ring->threadId, first);
+        }
+    }
+    writeMetadata(
+    file, "thread_name", gpuRing.threadName, gpuPid, gpuRing.threadId, first);
+    writeEvents(file, gpuRing.snapshot(), gpuPid, gpuRing.threadId, first);
+
+    file << "\n]}\n";
+}
+
+ProfileZone::ProfileZone(const char* name)
+    : name(name), begin(Profiler::get().now())
+{}
+
+ProfileZone::~ProfileZone()
+{
+    auto& profiler = Profiler::get();
+    profiler.recordCpu(name, begin, profiler.now());
+}
+}
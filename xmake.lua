@@ -1,12 +1,141 @@
 add_rules("mode.debug", "mode.release")
 
+option("spirv_opt")
+    set_default(true)
+    set_showmenu(true)
+    set_description("Run spirv-opt over the embedded shaders in release builds.")
+option_end()
+
+option("shaderc")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Compile GLSL shaders at runtime through shaderc.")
+    add_links("shaderc_shared")
+    add_defines("SUNSET_SHADERC")
+
+    -- The version keys the runtime shader cache, so that a new compiler does
+    -- not reuse code an old one generated. glslc ships with shaderc and
+    -- reports the same version as the library.
+    after_check(function (option)
+        if not option:enabled() then
+            return
+        end
+        import("lib.detect.find_tool")
+
+        local version = get_config("shaderc_version")
+        if not version or version == "" then
+            local glslc = find_tool("glslc", {version = true})
+            version = glslc and glslc.version
+        end
+        option:add("defines", format("SUNSET_SHADERC_VERSION=\"%s\"", version or "unknown"))
+    end)
+option_end()
+
+option("shaderc_version")
+    set_default("")
+    set_showmenu(true)
+    set_description("Version of the linked shaderc, detected from glslc when empty.")
+option_end()
+
+-- Compiles shaders to SPIR-V and embeds every module as a constexpr word
+-- array, listed by name in embedded_shaders.inc for
+-- src/renderer/vulkan/embedded_shaders.cpp. Names are paths relative to
+-- shader/, such as "basic.vert".
+rule("embed_spirv")
+    set_extensions(".vert", ".frag", ".comp")
+
+    on_load(function (target)
+        local outputdir = path.join(target:autogendir(), "rules", "embed_spirv")
+        os.mkdir(outputdir)
+        target:add("includedirs", outputdir)
+    end)
+
+    -- Only rewritten when the set of shaders changes, so that adding a
+    -- shader is the only thing that rebuilds the table.
+    on_config(function (target)
+        local outputdir = path.join(target:autogendir(), "rules", "embed_spirv")
+        local sourcebatch = target:sourcebatches()["embed_spirv"]
+        local includes = {}
+        local entries = {}
+        for _, sourcefile in ipairs(sourcebatch and sourcebatch.sourcefiles or {}) do
+            local name = path.relative(sourcefile, "shader"):gsub("\\", "/")
+            local symbol = name:gsub("[^%w]", "_")
+            table.insert(includes, string.format("#include \"%s.spv.inc\"", name))
+            table.insert(entries, string.format("    EmbeddedShader{\"%s\", %s},", name, symbol))
+        end
+
+        local tablefile = path.join(outputdir, "embedded_shaders.inc")
+        local content = string.format(
+            "// Generated by the embed_spirv rule, do not edit.\n%s\n\n" ..
+            "constexpr std::array<EmbeddedShader, %d> embeddedShaders{\n%s\n};\n",
+            table.concat(includes, "\n"), #entries, table.concat(entries, "\n"))
+        if not os.isfile(tablefile) or io.readfile(tablefile) ~= content then
+            io.writefile(tablefile, content)
+        end
+    end)
+
+    before_buildcmd_file(function (target, batchcmds, sourcefile, opt)
+        import("lib.detect.find_tool")
+
+        local glslang = assert(find_tool("glslangValidator"), "glslangValidator not found!")
+        -- Debug builds keep the debug info the optimizer would strip.
+        local spirvopt = has_config("spirv_opt") and not is_mode("debug") and find_tool("spirv-opt")
+
+        local outputdir = path.join(target:autogendir(), "rules", "embed_spirv")
+        local name = path.relative(sourcefile, "shader"):gsub("\\", "/")
+        local symbol = name:gsub("[^%w]", "_")
+        local spvfile = path.join(outputdir, name .. ".spv")
+        local headerfile = path.join(outputdir, name .. ".spv.inc")
+
+        batchcmds:show_progress(opt.progress, "${color.build.object}compiling.spirv %s", sourcefile)
+        batchcmds:mkdir(path.directory(spvfile))
+
+        local argv = {"--target-env", "vulkan1.0", "-o", path(spvfile), path(sourcefile)}
+        if is_mode("debug") then
+            table.insert(argv, 1, "-g")
+        end
+        batchcmds:vrunv(glslang.program, argv)
+        if spirvopt then
+            batchcmds:vrunv(spirvopt.program, {"-O", path(spvfile), "-o", path(spvfile)})
+        end
+        batchcmds:vrunv(os.programfile(), {
+            "lua", path(path.join(os.projectdir(), "scripts", "embed_spirv.lua")),
+            path(spvfile), path(headerfile), symbol}, {envs = {XMAKE_SKIP_HISTORY = "y"}})
+
+        batchcmds:add_depfiles(sourcefile, path.join(os.projectdir(), "scripts", "embed_spirv.lua"))
+        batchcmds:set_depmtime(os.mtime(headerfile))
+        batchcmds:set_depcache(target:dependfile(headerfile))
+    end)
+rule_end()
+
 target("sunset")
     set_kind("binary")
     set_languages("c++20")
     add_includedirs("inc")
     add_links("glfw","vulkan")
+    add_options("shaderc")
+    add_rules("embed_spirv")
     add_files("src/**.cpp")
+    add_files("shader/**.vert", "shader/**.frag", "shader/**.comp")
+
+    if is_mode("debug") then
+        add_defines("DEBUG")
+    end
+
+-- Headless frame time benchmark over canned scenes, see bench/main.cpp.
+target("sunset_bench")
+    set_kind("binary")
+    set_languages("c++20")
+    add_includedirs("inc", "bench")
+    add_links("glfw","vulkan")
+    add_options("shaderc")
+    add_rules("embed_spirv")
+    add_files("src/**.cpp|main.cpp", "bench/**.cpp")
+    add_files("shader/**.vert", "shader/**.frag", "shader/**.comp")
 
     if is_mode("debug") then
         add_defines("DEBUG")
     end
+    if is_plat("windows") then
+        add_syslinks("psapi")
+    end